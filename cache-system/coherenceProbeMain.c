@@ -0,0 +1,69 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../cache/utils.h"
+#include "../cache/mem.h"
+#include "../cache/memBackend.h"
+#include "../cache/getFromCache.h"
+#include "coherenceUtils.h"
+#include "coherenceRead.h"
+#include "coherenceWrite.h"
+
+/*
+	Checks that a read of a snooping system returns the data the reading
+	cache holds for the address afterwards, which is what reading the
+	address out of the cache again would return. A read that misses fills
+	the block its probe chose, so a fill that lands in any other block makes
+	the two differ. Runs a random trace of reads and writes for every
+	replacement policy and returns 1 if any read differs.
+*/
+int main() {
+	enum replacement policies[] = {LRU_REPLACEMENT, FIFO_REPLACEMENT, RANDOM_REPLACEMENT, PLRU_REPLACEMENT,
+		SRRIP_REPLACEMENT, BRRIP_REPLACEMENT, LIP_REPLACEMENT, STAMP_LRU_REPLACEMENT};
+	uint32_t numCaches = 3;
+	uint32_t n = 4;
+	uint32_t blockDataSize = 16;
+	uint32_t totalDataSize = 256;
+	uint32_t span = 4 * totalDataSize;
+	uint64_t state = 88172645463325252ULL;
+	long mismatches = 0;
+
+	for (unsigned int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+		memBackend_t* memory = createArenaBackend();
+		cacheNode_t** lst = malloc(sizeof(cacheNode_t*) * numCaches);
+		for (uint32_t i = 0; i < numCaches; i++) {
+			cacheOptions_t options = defaultCacheOptions();
+			options.backend = memory;
+			options.replacement = policies[p];
+			lst[i] = createCacheNode(createCacheWithOptions(n, blockDataSize, totalDataSize, NULL, &options), i + 1);
+		}
+		cacheSystem_t* sys = createCacheSystem(lst, numCaches, createSnooper());
+		for (int i = 0; i < 20000; i++) {
+			state ^= state << 13;
+			state ^= state >> 7;
+			state ^= state << 17;
+			uint32_t address = (MIN_ADDRESS + (uint32_t) (state % span)) & ~3u;
+			uint8_t ID = 1 + (state >> 32) % numCaches;
+			if ((state >> 40) & 1) {
+				cacheSystemWordWrite(sys, address, ID, (uint32_t) (state >> 16));
+				continue;
+			}
+			uint8_t data[4];
+			uint8_t held[4];
+			cache_t* cache = getCacheFromID(sys, ID);
+			cacheSystemReadInto(sys, address, ID, 4, data);
+			evictionInfo_t block = lookupBlock(cache, address);
+			getDataInto(cache, getOffset(cache, address), block.blockNumber, 4, held);
+			if (!block.match || memcmp(data, held, 4) != 0) {
+				mismatches++;
+			}
+		}
+		deleteCacheSystem(sys);
+		releaseMemBackend(memory);
+	}
+	printf("%ld reads differ from the data held by the reading cache\n", mismatches);
+	return mismatches != 0;
+}
@@ -1,7 +1,10 @@
 /* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "coherenceUtils.h"
+#include "directory.h"
 #include "coherenceRead.h"
 #include "../cache/utils.h"
 #include "../cache/setInCache.h"
@@ -9,59 +12,73 @@
 #include "../cache/cacheRead.h"
 #include "../cache/cacheWrite.h"
 #include "../cache/mem.h"
+#include "../cache/replacement.h"
 #include "../hitrate/hitRate.h"
 
+/*
+	Takes in a cache, the block number of a block that holds the address,
+	and a size and copies size bytes at the address out of the block into
+	data, updating the replacement policy as on a hit, without looking the
+	address up again.
+*/
+static void readProbedBlock(cache_t* cache, uint32_t blockNumber, uint32_t address, uint8_t size, uint8_t* data) {
+	getDataInto(cache, getOffset(cache, address), blockNumber, size, data);
+	cache->policy->onHit(cache, blockNumber);
+}
+
 /*
 	A function which processes all cache reads for an entire cache system.
 	Takes in a cache system, an address, an id for a cache, and a size to read
 	and calls the appropriate functions on the cache being selected to read
 	the data. Returns the data.
 */
+uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size) {
+	uint8_t* retVal = malloc(sizeof(uint8_t) * size);
+	if (retVal == NULL) {
+		allocationFailed();
+	}
+	cacheSystemReadInto(cacheSystem, address, ID, size, retVal);
+	return retVal;
+}
+
+/*
+	Works the same as cacheSystemRead but copies the data that was read into
+	the buffer passed in, which must hold at least size bytes, instead of
+	allocating a new one.
+*/
 
 // Assume that size <= blockDataSize, deal with that in the higher order functions
-uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size) {
-	uint8_t* retVal;
+void cacheSystemReadInto(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size, uint8_t* retVal) {
+	if (cacheSystem->mode == DIRECTORY_COHERENCE) {
+		directoryReadInto(cacheSystem, address, ID, size, retVal);
+		return;
+	}
 	uint8_t offset;
-	uint8_t* transferData;
-	evictionInfo_t* dstCacheInfo;
-	evictionInfo_t* otherCacheInfo;
+	probeInfo_t dstCacheInfo;
+	probeInfo_t otherCacheInfo;
 	uint32_t evictionBlockNumber;
 	cacheNode_t** caches;
 	bool otherCacheContains = false;
 	cache_t* dstCache = NULL;
-	uint8_t counter = 0;
 	caches = cacheSystem->caches;
-	while (dstCache == NULL && counter < cacheSystem->size) { //Selects destination cache pointer from array of caches pointers
-		if (caches[counter]->ID == ID) {
-			dstCache = caches[counter]->cache;
-		}
-		counter++;
+	dstCache = cacheSystem->nodesByID[ID]->cache; //Selects destination cache pointer from the ID table
+	uint8_t* transferData = takeBlockBuffer(dstCache);
+	dstCacheInfo = probeBlock(dstCache, address); //Finds potential match and its state
+	if (!dstCacheInfo.block.match) {
+		dstCacheInfo.block = chooseVictim(dstCache, address); //Finds block to evict
 	}
-	dstCacheInfo = findEviction(dstCache, address); //Finds block to evict and potential match
-	evictionBlockNumber = dstCacheInfo->blockNumber;
+	evictionBlockNumber = dstCacheInfo.block.blockNumber;
 	offset = getOffset(dstCache, address);
+	reportAccess(dstCache);
 
 	// Check for valid address?
 
-	if (dstCacheInfo->match) {
+	if (dstCacheInfo.block.match) {
 		/*What do you do if it is in the cache?*/
 		/*Your Code Here*/
-		enum state dstCacheState = determineState(dstCache, address);
-
-		// Modified: up-to-date and only copy
-		if (dstCacheState == MODIFIED || dstCacheState == EXCLUSIVE) {
-			// need to return later
-			retVal = readFromCache(dstCache, address, size);
-
-		// Owner: up-to-date, other caches have a shared copy
-		} else if (dstCacheState == OWNED) {
-			// maybe don't have to check other caches
-			retVal = readFromCache(dstCache, address, size);
-
-		// May have to update retVal if another cache has more recent data
-		} else if (dstCacheState == SHARED) {
-			retVal = readFromCache(dstCache, address, size);
-		}
+		// every valid state holds up-to-date data, so the read is served here
+		reportHit(dstCache);
+		readProbedBlock(dstCache, evictionBlockNumber, address, size, retVal);
 
 	} else {
 		uint32_t oldAddress = extractAddress(dstCache, extractTag(dstCache, evictionBlockNumber), evictionBlockNumber, 0);
@@ -72,22 +89,20 @@ uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 		// need to remove Invalid block from snooper
 		removeFromSnooper(cacheSystem->snooper, oldAddress, ID, dstCache->blockDataSize);
 
-		evict(dstCache, dstCacheInfo->blockNumber); //
+		evict(dstCache, evictionBlockNumber); //
 
-		setState(dstCache, dstCacheInfo->blockNumber, INVALID);
-		uint32_t oldAddrTag = getTag(dstCache, oldAddress);
-		uint32_t oldAddrIndex = getIndex(dstCache, oldAddress);
-		long oldLRU = dstCacheInfo->LRU;
-		decrementLRU(dstCache, oldAddrTag, oldAddrIndex, oldLRU);
+		decrementLRU(dstCache, evictionBlockNumber);
+		setState(dstCache, evictionBlockNumber, INVALID);
 
 		cache_t* temp;
 		for (int i = 0; i < cacheSystem->size; i++) {
 			if (caches[i]->ID != ID && snooperContains(cacheSystem->snooper, oldAddress, caches[i]->ID)) {
 				temp = caches[i]->cache;
-				if (returnIDIf1(cacheSystem->snooper, oldAddress, cacheSystem->blockDataSize) == -1 && determineState(temp, oldAddress) == SHARED) {
+				probeInfo_t tempInfo = probeBlock(temp, oldAddress);
+				if (returnIDIf1(cacheSystem->snooper, oldAddress, cacheSystem->blockDataSize) == -1 && tempInfo.state == SHARED) {
 					continue;
 				}
-				updateState(temp, oldAddress, INVALID);
+				updateProbedState(temp, tempInfo, INVALID);
 			}
 		}
 
@@ -96,55 +111,22 @@ uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 		/*Check other caches???*/
 		/*Your Code Here*/
 		while (val != -1) {
-			cache_t* other;
-			for (int i = 0; i < cacheSystem->size; i++) {
-				if (caches[i]->ID == val) {
-					other = caches[i]->cache;
-					break;
-				}
-			}
-			otherCacheInfo = findEviction(other, address);
-			enum state otherState = determineState(other, address);
+			cache_t* other = cacheSystem->nodesByID[val]->cache;
+			otherCacheInfo = probeBlock(other, address);
 
 			// Copy data from other cache, set current cache to SHARED
-			if (otherCacheInfo->match) {
+			if (otherCacheInfo.block.match) {
 				otherCacheContains = true;
-				if (otherState == SHARED || otherState == OWNED) {
-					transferData = fetchBlock(other, otherCacheInfo->blockNumber);
-					writeToCache(dstCache, address, transferData, cacheSystem->blockDataSize);
-					free(otherCacheInfo);
-					free(transferData);
-					retVal = readFromCache(dstCache, address, size);
-					break;
 
-				} else if (otherState == EXCLUSIVE) {
-					transferData = fetchBlock(other, otherCacheInfo->blockNumber);
-					writeToCache(dstCache, address, transferData, cacheSystem->blockDataSize);
-					free(otherCacheInfo);
-					free(transferData);
-					retVal = readFromCache(dstCache, address, size);
-					break;
-				} else if (otherState == MODIFIED) {
-					transferData = fetchBlock(other, otherCacheInfo->blockNumber);
-					writeToCache(dstCache, address, transferData, cacheSystem->blockDataSize);
-					free(otherCacheInfo);
-					free(transferData);
-					retVal = readFromCache(dstCache, address, size);
-					break;
-				}
+				// every state that holds the block holds up-to-date data
+				fetchBlockInto(other, otherCacheInfo.block.blockNumber, transferData);
+				fillProbedBlock(dstCache, address, &dstCacheInfo.block, transferData);
+				readProbedBlock(dstCache, evictionBlockNumber, address, size, retVal);
+				break;
 
-			// Not sure if we have to clear other cache from snooper if match is a miss
+			// the cache no longer holds the block, so only the snooper is out of date
 			} else {
-				if (otherState == INVALID) {
-					removeFromSnooper(cacheSystem->snooper, address, val, other->blockDataSize);
-					evict(other, otherCacheInfo->blockNumber);
-					setState(other, otherCacheInfo->blockNumber, INVALID);
-					uint32_t addrTag = getTag(other, address);
-					uint32_t addrIndex = getIndex(other, address);
-					oldLRU = otherCacheInfo->LRU;
-					decrementLRU(other, addrTag, addrIndex, oldLRU);
-					free(otherCacheInfo);
-				}
+				removeFromSnooper(cacheSystem->snooper, address, val, other->blockDataSize);
 			}
 			val = returnFirstCacheID(cacheSystem->snooper, address, cacheSystem->blockDataSize);
 		}
@@ -155,8 +137,9 @@ uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 
 			// If block is not present, readFromCache should readFromMem and write to the cache
 			// block should now be exclusive
-			retVal = readFromMem(dstCache, address);
-			writeToCache(dstCache, address, retVal, cacheSystem->blockDataSize);
+			readFromMemInto(dstCache, address - offset, transferData);
+			fillProbedBlock(dstCache, address, &dstCacheInfo.block, transferData);
+			memcpy(retVal, transferData + offset, size);
 			setState(dstCache, evictionBlockNumber, EXCLUSIVE);
 		}
 
@@ -166,13 +149,13 @@ uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 		/*What states need to be updated?*/
 		/*Your Code Here*/
 		enum state newState;
-		if (dstCacheInfo->match) {
-			newState = determineState(dstCache, address);
+		if (dstCacheInfo.block.match) {
+			newState = dstCacheInfo.state;
 		} else {
 			if (returnIDIf1(cacheSystem->snooper, address, cacheSystem->blockDataSize) == ID) {
 				setState(dstCache, evictionBlockNumber, EXCLUSIVE);
 				newState = EXCLUSIVE;
-			} else if (determineState(dstCache, address) == OWNED) {
+			} else if (getState(dstCache, evictionBlockNumber) == OWNED) {
 				newState = OWNED;
 			} else {
 				setState(dstCache, evictionBlockNumber, SHARED);
@@ -188,8 +171,7 @@ uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 			}
 		}
 	}
-	free(dstCacheInfo);
-	return retVal;
+	releaseBlockBuffer(cacheSystem->nodesByID[ID]->cache);
 }
 
 /*
@@ -204,15 +186,7 @@ byteInfo_t cacheSystemByteRead(cacheSystem_t* cacheSystem, uint32_t address, uin
 		retVal.success = false;
 		return retVal;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		retVal.success = false;
 		return retVal;
 	}
@@ -220,10 +194,10 @@ byteInfo_t cacheSystemByteRead(cacheSystem_t* cacheSystem, uint32_t address, uin
 	if (validAddresses(address, 1) == 0) {
 		retVal.success = false;
 	} else {
-		uint8_t* data = cacheSystemRead(cacheSystem, address, ID, 1);
+		uint8_t data[1];
+		cacheSystemReadInto(cacheSystem, address, ID, 1, data);
 		retVal.data = data[0];
 		retVal.success = true;
-		free(data);
 	}
 	return retVal;
 }
@@ -240,15 +214,7 @@ halfWordInfo_t cacheSystemHalfWordRead(cacheSystem_t* cacheSystem, uint32_t addr
 		retVal.success = false;
 		return retVal;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		retVal.success = false;
 		return retVal;
 	}
@@ -266,11 +232,11 @@ halfWordInfo_t cacheSystemHalfWordRead(cacheSystem_t* cacheSystem, uint32_t addr
 				address++;
 			}
 		} else {
-			uint8_t* data = cacheSystemRead(cacheSystem, address, ID, 2);
+			uint8_t data[2];
+			cacheSystemReadInto(cacheSystem, address, ID, 2, data);
 			for (int i = 0; i < 2; i ++) {
 				retVal.data += ((uint16_t) data[i] << (8 * (1 - i)));
 			}
-			free(data);
 		}
 		retVal.success = true;
 	}
@@ -290,15 +256,7 @@ wordInfo_t cacheSystemWordRead(cacheSystem_t* cacheSystem, uint32_t address, uin
 		retVal.success = false;
 		return retVal;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		retVal.success = false;
 		return retVal;
 	}
@@ -315,11 +273,11 @@ wordInfo_t cacheSystemWordRead(cacheSystem_t* cacheSystem, uint32_t address, uin
 				address += 2;
 			}
 		} else {
-			uint8_t* data = cacheSystemRead(cacheSystem, address, ID, 4);
+			uint8_t data[4];
+			cacheSystemReadInto(cacheSystem, address, ID, 4, data);
 			for (int i = 0; i < 4; i ++) {
 				retVal.data += ((uint32_t) data[i] << (8 * (3 - i)));
 			}
-			free(data);
 		}
 		retVal.success = true;
 	}
@@ -338,15 +296,7 @@ doubleWordInfo_t cacheSystemDoubleWordRead(cacheSystem_t* cacheSystem, uint32_t
 		retVal.success = false;
 		return retVal;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		retVal.success = false;
 		return retVal;
 	}
@@ -363,11 +313,11 @@ doubleWordInfo_t cacheSystemDoubleWordRead(cacheSystem_t* cacheSystem, uint32_t
 				address += 4;
 			}
 		} else {
-			uint8_t* data = cacheSystemRead(cacheSystem, address, ID, 8);
+			uint8_t data[8];
+			cacheSystemReadInto(cacheSystem, address, ID, 8, data);
 			for (int i = 0; i < 8; i ++) {
 				retVal.data += ((uint64_t) data[i] << (8 * (7 - i)));
 			}
-			free(data);
 		}
 		retVal.success = true;
 	}
@@ -10,6 +10,13 @@
 */
 uint8_t* cacheSystemRead(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size);
 
+/*
+	Works the same as cacheSystemRead but copies the data that was read into
+	the buffer passed in, which must hold at least size bytes, instead of
+	allocating a new one.
+*/
+void cacheSystemReadInto(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size, uint8_t* retVal);
+
 /*
 	A function used to request a byte from a specific cache in a cache system.
 	Takes in a cache system, an address, and an ID for the cache which will be
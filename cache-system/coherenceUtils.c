@@ -8,6 +8,10 @@
 #include "../cache/utils.h"
 #include "../cache/setInCache.h"
 #include "../cache/getFromCache.h"
+#include "../cache/cacheWrite.h"
+#include "../cache/replacement.h"
+#include "../cache/memBackend.h"
+#include "../cache/bitfield.h"
 
 /*
 	Used to indicate that a cache system has an invalid number
@@ -56,6 +60,60 @@ void memError() {
 	fprintf(stderr, "\nError: Caches are not in a system. At least 1 cache uses different main memory\n");
 }
 
+/*
+	Used to indicate at least 1 cache has a victim cache, which is private
+	to its cache and is not kept coherent with the other caches.
+*/
+void victimCacheError() {
+	fprintf(stderr, "\nError: Caches in a system cannot have a victim cache\n");
+}
+
+/*
+	Used to indicate at least 1 cache has a prefetcher, whose fills do not
+	go through the coherence protocol.
+*/
+void prefetcherError() {
+	fprintf(stderr, "\nError: Caches in a system cannot have a prefetcher\n");
+}
+
+/*
+	Used to indicate at least 1 cache is write through or does not write
+	allocate, which the MOESI states kept in the dirty and shared bits do not
+	support.
+*/
+void writePolicyError() {
+	fprintf(stderr, "\nError: Caches in a system must be write back and write allocate\n");
+}
+
+/*
+	Used to indicate at least 1 cache is sectored. Blocks are moved between
+	caches whole, so every sector of a block would have to be valid.
+*/
+void sectorError() {
+	fprintf(stderr, "\nError: Caches in a system cannot be sectored\n");
+}
+
+/*
+	Used to indicate at least 1 cache has upper levels or sits above an
+	inclusive or exclusive level. Snooping only keeps the caches in the
+	system coherent, not the blocks those levels move between each other.
+*/
+void hierarchyError() {
+	fprintf(stderr, "\nError: Caches in a system cannot be in an inclusive or exclusive hierarchy\n");
+}
+
+/*
+	Takes in a cache and returns whether it is part of a hierarchy that a
+	cache system cannot keep coherent. Caches above a non-inclusive non-exclusive level may share
+	it like they would share physical memory.
+*/
+static bool inHierarchy(cache_t* cache) {
+	if (cache->numUppers != 0) {
+		return true;
+	}
+	return cache->backend->type == CACHE_BACKEND && cache->backend->cache->inclusion != NINE_LEVEL;
+}
+
 /*
 	Function that takes in a pointer to a cache and an ID number and creates
 	a cache node. You CAN assume that the cache has already been properly
@@ -76,11 +134,23 @@ cacheNode_t* createCacheNode(cache_t* cache, uint8_t ID) {
 	nodes and a size and returns a pointer to the cache system.
 	All caches must have the same block data size and no two caches can share
 	an ID. In addition all caches in a system must share the same main memory
-	source. IF any condition is failed call the appropriate error function
-	and return NULL.
+	source, which means they must hold the same physical memory backend, and
+	no cache can have a victim cache or a prefetcher or be sectored. Every
+	cache must be write back and write allocate.
+	IF any condition is failed call the appropriate error function
+	and return NULL. The system keeps its caches coherent by snooping.
+*/
+cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint32_t size, snoopy_t* snooper) {
+	return createCacheSystemWithMode(caches, size, snooper, SNOOP_COHERENCE);
+}
+
+/*
+	Creates a cache system in the same way as createCacheSystem but keeps
+	its caches coherent with the selected mode. A DIRECTORY_COHERENCE system
+	keeps its directory in the snooper, which must be empty.
 */
-cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint8_t size, snoopy_t* snooper) {
-	char* memFile;
+cacheSystem_t* createCacheSystemWithMode(cacheNode_t** caches, uint32_t size, snoopy_t* snooper, enum coherenceMode mode) {
+	struct memBackend* backend;
 	int ID;
 	cache_t* cache;
 	if (caches == NULL) {
@@ -91,7 +161,7 @@ cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint8_t size, snoopy_t* s
 		invalidCacheNumber();
 		return NULL;
 	}
-	if (snooper == NULL) {
+	if (snooper == NULL || (mode == DIRECTORY_COHERENCE && snooper->numContents != 0)) {
 		snooperError();
 		return NULL;
 	}
@@ -104,21 +174,56 @@ cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint8_t size, snoopy_t* s
 	uint32_t blockDataSize = caches[0]->cache->blockDataSize;
 	ID_Array[0] = caches[0]->ID;
 	cache_Array[0] = caches[0]->cache;
-	memFile = caches[0]->cache->physicalMemoryName;
-	for (uint8_t i = 1; i < size; i++) {
+	backend = caches[0]->cache->backend;
+	if (caches[0]->cache->victim != NULL) {
+		victimCacheError();
+		return NULL;
+	}
+	if (caches[0]->cache->prefetcher != NULL) {
+		prefetcherError();
+		return NULL;
+	}
+	if (caches[0]->cache->writePolicy != WRITE_BACK || !caches[0]->cache->writeAllocate) {
+		writePolicyError();
+		return NULL;
+	}
+	if (caches[0]->cache->sectorSize != 0) {
+		sectorError();
+		return NULL;
+	}
+	if (inHierarchy(caches[0]->cache)) {
+		hierarchyError();
+		return NULL;
+	}
+	for (uint32_t i = 1; i < size; i++) {
 		if (caches[i] == NULL || caches[i]->cache == NULL) {
 			nullCacheError();
 			return NULL;
+		} else if (caches[i]->cache->victim != NULL) {
+			victimCacheError();
+			return NULL;
+		} else if (caches[i]->cache->prefetcher != NULL) {
+			prefetcherError();
+			return NULL;
+		} else if (caches[i]->cache->writePolicy != WRITE_BACK || !caches[i]->cache->writeAllocate) {
+			writePolicyError();
+			return NULL;
+		} else if (caches[i]->cache->sectorSize != 0) {
+			sectorError();
+			return NULL;
+		} else if (inHierarchy(caches[i]->cache)) {
+			hierarchyError();
+			return NULL;
 		} else if (caches[i]->cache->blockDataSize != blockDataSize) {
 			blockSizeError();
 			return NULL;
-		} else if (strcmp(caches[i]->cache->physicalMemoryName, memFile)) {
+		} else if (caches[i]->cache->backend != backend) {
 			memError();
 			return NULL;
 		} else {
 			ID = caches[i]->ID;
 			cache = caches[i]->cache;
-			for (uint8_t j = 0; j < i; j++) {
+			for (uint32_t j = 0; j < i; j++) {
 				if (ID == ID_Array[j]) {
 					duplicateIDError();
 					return NULL;
@@ -137,9 +242,15 @@ cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint8_t size, snoopy_t* s
 		allocationFailed();
 	}
 	sys->caches = caches;
+	memset(sys->nodesByID, 0, sizeof(sys->nodesByID));
+	for (uint32_t i = 0; i < size; i++) {
+		sys->nodesByID[caches[i]->ID] = caches[i];
+	}
 	sys->size = size;
 	sys->blockDataSize = blockDataSize;
 	sys->snooper = snooper;
+	sys->mode = mode;
+	sys->locks = NULL;
 	return sys;
 }
 
@@ -165,33 +276,52 @@ void deleteCacheSystem(cacheSystem_t* cacheSystem) {
 	valid for the cache system then it returns a NULL pointer.
 */
 cache_t* getCacheFromID(cacheSystem_t* cacheSystem, uint8_t ID) {
-	cacheNode_t* node;
-	uint8_t size = cacheSystem->size;
-	for (unsigned int i = 0; i < size; i++) {
-		node = cacheSystem->caches[i];
-		if (node->ID == ID) {
-			return node->cache;
-		}
-	}
-	return NULL;
+	cacheNode_t* node = cacheSystem->nodesByID[ID];
+	return node == NULL ? NULL : node->cache;
 }
 
 /*
-	Takes in a cache and an address and determines the state of the block
-	containing that address in the cache.
+	Takes in a cache and an address and looks the address up in its set
+	once without changing the replacement policy. Returns the lookup of the
+	address along with the state of the address in the cache.
 */
-enum state determineState(cache_t* cache, uint32_t address) {
-	evictionInfo_t* block = findEviction(cache, address);
-	if (block->match == false) {
-		free(block);
-		return INVALID;
-	}
+probeInfo_t probeBlock(cache_t* cache, uint32_t address) {
+	probeInfo_t probe;
+	probe.block = lookupBlock(cache, address);
+	probe.state = probe.block.match ? getState(cache, probe.block.blockNumber) : INVALID;
+	return probe;
+}
 
-	uint32_t blockNumber = block->blockNumber;
-	uint8_t valid = getValid(cache, blockNumber);
-	uint8_t dirty = getDirty(cache, blockNumber);
-	uint8_t shared = getShared(cache, blockNumber);
-	free(block);
+/*
+	Takes in a cache, an address that missed in the cache, the eviction info
+	of its probe, and the data of the whole block of the address, and places
+	the block in the probed block once whatever it held has been evicted.
+	The block is filled like writeToCache fills it, so it is MODIFIED
+	afterwards, but the address is not looked up again. Returns the
+	eviction info of the block, which now holds the address.
+*/
+evictionInfo_t fillProbedBlock(cache_t* cache, uint32_t address, evictionInfo_t* block, uint8_t* data) {
+	uint32_t tag = getTag(cache, address);
+	writeDataToCache(cache, address - getOffset(cache, address), data, cache->blockDataSize, block);
+	setTag(cache, tag, block->blockNumber);
+	evictionInfo_t filled = *block;
+	filled.match = true;
+	return filled;
+}
+
+/*
+	Takes in a cache and the block number of a valid block and returns the
+	state of the block, read from its valid, dirty, and shared bits at once.
+*/
+enum state getState(cache_t* cache, uint32_t blockNumber) {
+	uint8_t flags;
+	if (cache->layout == ALIGNED) {
+		flags = cache->flags[blockNumber];
+	} else {
+		// the valid, dirty, and shared bits lead the block in that order
+		uint64_t bits = readBits(cache->contents, getValidLocation(cache, blockNumber), 3);
+		flags = (bits & 4 ? VALID_FLAG : 0) | (bits & 2 ? DIRTY_FLAG : 0) | (bits & 1 ? SHARED_FLAG : 0);
+	}
 
 	/**********************************************
 	 	|| Valid || Dirty | Shared | State   ||
@@ -204,21 +334,19 @@ enum state determineState(cache_t* cache, uint32_t address) {
 	 	||   1   ||   1   |    0   | MODIF.  ||
 	 	||   1   ||   1   |    1   | OWNED   ||
 	 *********************************************/
-	if (valid == 0) {
+	static const enum state states[4] = {EXCLUSIVE, SHARED, MODIFIED, OWNED};
+	if (!(flags & VALID_FLAG)) {
 		return INVALID;
-	} else {
-		if (dirty == 0 && shared == 0) {
-		return EXCLUSIVE;
-		}
-		if (dirty == 0 && shared == 1) {
-			return SHARED;
-		}
-		if (dirty == 1 && shared == 0) {
-			return MODIFIED;
-		} else {
-			return OWNED;
-		}
 	}
+	return states[((flags & DIRTY_FLAG) ? 2 : 0) | ((flags & SHARED_FLAG) ? 1 : 0)];
+}
+
+/*
+	Takes in a cache and an address and determines the state of the block
+	containing that address in the cache.
+*/
+enum state determineState(cache_t* cache, uint32_t address) {
+	return probeBlock(cache, address).state;
 }
 
 /*
@@ -255,25 +383,28 @@ void setState(cache_t* cache, uint32_t blockNumber, enum state newState) {
 	a cache.
 */
 void updateState(cache_t* cache, uint32_t address, enum state otherState) {
-	evictionInfo_t* block = findEviction(cache, address);
-	enum state currState = determineState(cache, address);
+	updateProbedState(cache, probeBlock(cache, address), otherState);
+}
+
+/*
+	Works the same as updateState but takes the probe of the address in the
+	cache instead of looking the address up again. The probe must have been
+	made after the last change to the set of the address.
+*/
+void updateProbedState(cache_t* cache, probeInfo_t probe, enum state otherState) {
+	enum state currState = probe.state;
 
 	// If current cache block is INVALID, should remain INVALID independent of other caches
 	if (currState == INVALID) {
-		free(block);
 		return;
 	}
 
 	// If other cache is modified, current cache must be invalid
 	// modified - no other cache has a copy
 	if (otherState == MODIFIED) {
-		uint32_t addrTag = getTag(cache, address);
-		uint32_t addrIndex = getIndex(cache, address);
-		long oldLRU = block->LRU;
-
 		// Need to reset invalidated LRU to max + decrement all other LRUs by 1
-		setState(cache, block->blockNumber, INVALID);
-		decrementLRU(cache, addrTag, addrIndex, oldLRU);
+		decrementLRU(cache, probe.block.blockNumber);
+		setState(cache, probe.block.blockNumber, INVALID);
 
 
 	} else if (otherState == OWNED) {
@@ -287,81 +418,73 @@ void updateState(cache_t* cache, uint32_t address, enum state otherState) {
 	} else if (otherState == SHARED) {
 		// current cache has the most updated 
 		if (currState == MODIFIED) {
-			setState(cache, block->blockNumber, OWNED);
+			setState(cache, probe.block.blockNumber, OWNED);
 		}
 		if (currState == EXCLUSIVE) {
-			setState(cache, block->blockNumber, SHARED);
+			setState(cache, probe.block.blockNumber, SHARED);
 		}
 
 	} else if (otherState == INVALID) {
 		// If cache is currently owned, then other state must have originally been shared
 		// Therefore, changes to modified
 		if (currState == OWNED) {
-			setState(cache, block->blockNumber, MODIFIED);
+			setState(cache, probe.block.blockNumber, MODIFIED);
 		} else if (currState == SHARED) {
-			setState(cache, block->blockNumber, EXCLUSIVE);
+			setState(cache, probe.block.blockNumber, EXCLUSIVE);
 		}
 	}
-	free(block);
 
 }
 
 /*
-	Creates a new snooper with 8 buckets.
+	Takes in a snooper entry and returns whether no cache shares its block,
+	which means the slot is empty.
 */
-snoopy_t* createSnooper() {
-	snoopy_t* snoopy = malloc(sizeof(snoopy_t));
-	snoopy->buckets = malloc(sizeof(snoopBucket_t*) << 3);
-	for (int i = 0; i < 8; i++) {
-		snoopy->buckets[i] = createBucket();
+static bool emptySlot(snoopEntry_t* entry) {
+	for (int i = 0; i < SHARER_WORDS; i++) {
+		if (entry->sharers[i] != 0) {
+			return false;
+		}
 	}
-	snoopy->numBuckets = 8;
-	snoopy->numContents = 0;
-	return snoopy;
+	return true;
 }
 
 /*
-	Takes in a snooper and deletes all the elements.
+	Takes in a snooper and an address and returns the slot that holds the
+	address or the empty slot that ends its probe sequence if no slot does.
 */
-void deleteSnooper(snoopy_t* snooper) {
-	addressList_t* lst;
-	addressList_t* nxtlst;
-	snoopBucket_t* bucket;
-	for (int i = 0; i < snooper->numBuckets; i++) {
-		bucket = snooper->buckets[i];
-		if (bucket->lst) {
-			lst = bucket->lst;
-			while (lst) {
-				nxtlst = lst->next;
-				free(lst);
-				lst = nxtlst;
-			}		
-		}
-		free(bucket);
+static uint32_t findSlot(snoopy_t* snooper, uint32_t address) {
+	uint32_t mask = snooper->numSlots - 1;
+	uint32_t slot = hash(address) & mask;
+	while (!emptySlot(&(snooper->entries[slot])) && snooper->entries[slot].address != address) {
+		slot = (slot + 1) & mask;
 	}
-	free(snooper->buckets);
-	free(snooper);
+	return slot;
 }
 
 /*
-	Creates a bucket for the snooper.
+	Creates a new snooper with 8 slots.
 */
-snoopBucket_t* createBucket() {
-	snoopBucket_t* bucket;
-	bucket = malloc(sizeof(snoopBucket_t));
-	bucket->lst = NULL;
-	return bucket;
+snoopy_t* createSnooper() {
+	snoopy_t* snoopy = malloc(sizeof(snoopy_t));
+	if (snoopy == NULL) {
+		allocationFailed();
+	}
+	snoopy->entries = calloc(8, sizeof(snoopEntry_t));
+	if (snoopy->entries == NULL) {
+		allocationFailed();
+	}
+	snoopy->numSlots = 8;
+	snoopy->numContents = 0;
+	return snoopy;
 }
 
 /*
-	Creates a new list to keep track of IDs and addresses.
+	Takes in a snooper and deletes all the elements.
 */
-addressList_t* createList(uint32_t address, uint8_t ID, addressList_t* next) {
-	addressList_t* lst = malloc(sizeof(addressList_t));
-	lst->address = address;
-	lst->ID = ID;
-	lst->next = next;
-	return lst;
+void deleteSnooper(snoopy_t* snooper) {
+	free(snooper->entries);
+	free(snooper);
 }
 
 /*
@@ -372,77 +495,116 @@ uint32_t hash(uint32_t address) {
 }
 
 /*
-	Adds a new list to the snooper. If a list with the same address and ID is already
-	there it does nothing. Otherwise it finds its appropriate bucket for that address and
-	appends it to the front of our list. If capacity becomes twice the number of buckets
-	the number of buckets should shift.
+	Adds the ID to the sharers of the block of the address. If the ID
+	already shares the block it does nothing. If the block is new and the
+	table would become more than half full the number of slots doubles
+	first.
 */
 void addToSnooper(snoopy_t* snooper, uint32_t address, uint8_t ID, uint32_t blockDataSize) {
-	uint32_t hashVal;
 	address = address & ~(blockDataSize - 1);
-	if (!snooperContains(snooper, address, ID)) {
-		snooper->numContents++;
-		if (snooper->numContents >= (snooper->numBuckets << 1)) {
+	snoopEntry_t* entry = &(snooper->entries[findSlot(snooper, address)]);
+	if (emptySlot(entry)) {
+		if ((uint64_t) (snooper->numContents + 1) << 1 > snooper->numSlots) {
 			resizeSnooper(snooper);
+			entry = &(snooper->entries[findSlot(snooper, address)]);
 		}
-		hashVal = hash(address) & (snooper->numBuckets - 1);
-		snooper->buckets[hashVal]->lst = createList(address, ID, snooper->buckets[hashVal]->lst);
+		entry->address = address;
+		snooper->numContents++;
 	}
+	entry->sharers[ID >> 6] |= UINT64_C(1) << (ID & 63);
 }
 
 /*
-	Takes in a snooper, an address, and an ID. Returns true if the snooper
-	contains a list containing the address and ID.	
+	Takes in a snooper, an address, and a block size and returns the entry
+	of the block of the address. Returns NULL if no cache holds the block.
+	The entry moves when the snooper is changed.
+*/
+snoopEntry_t* findSnoopEntry(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize) {
+	address = address & ~(blockDataSize - 1);
+	snoopEntry_t* entry = &(snooper->entries[findSlot(snooper, address)]);
+	return emptySlot(entry) ? NULL : entry;
+}
+
+/*
+	Takes in a snooper, an address, and an ID. Returns true if the cache
+	with the ID shares the block at the address.
 */
 bool snooperContains(snoopy_t* snooper, uint32_t address, uint8_t ID) {
-	uint32_t hashVal;
-	hashVal = hash(address) & (snooper->numBuckets - 1);
-	addressList_t* lst = snooper->buckets[hashVal]->lst;
-	while (lst) {
-		if (lst->address == address && lst->ID == ID) {
-			return true;
-		}
-		lst = lst->next;
-	}
-	return false;
+	snoopEntry_t* entry = &(snooper->entries[findSlot(snooper, address)]);
+	return (entry->sharers[ID >> 6] >> (ID & 63)) & 1;
 }
 
 /*
-	Resizes the snooper if the load factor becomes >= 2.
+	Doubles the number of slots in the snooper and places every entry again.
 */
 void resizeSnooper(snoopy_t* snooper) {
-	uint32_t hashVal;
-	snoopBucket_t* bucket;
-	addressList_t* frontlst = NULL;
-	addressList_t* lstMover = NULL;
-	for (int i = 0; i < snooper->numBuckets; i++) {
-		bucket = snooper->buckets[i];
-		if (bucket->lst) {
-			if (frontlst == NULL) {
-				frontlst = bucket->lst;
-				lstMover = bucket->lst;
-			} else {
-				lstMover->next = bucket->lst;
-			}
-			while (lstMover->next) {
-				lstMover = lstMover->next;
-			}
+	snoopEntry_t* old = snooper->entries;
+	uint32_t oldSlots = snooper->numSlots;
+	snooper->numSlots = oldSlots << 1;
+	snooper->entries = calloc(snooper->numSlots, sizeof(snoopEntry_t));
+	if (snooper->entries == NULL) {
+		allocationFailed();
+	}
+	for (uint32_t i = 0; i < oldSlots; i++) {
+		if (!emptySlot(&(old[i]))) {
+			snooper->entries[findSlot(snooper, old[i].address)] = old[i];
 		}
-		bucket->lst = NULL;
 	}
-	snooper->numBuckets = (snooper->numBuckets) << 1;
-	snooper->buckets = realloc(snooper->buckets, sizeof(snoopBucket_t*) << log_2(snooper->numBuckets));
-	for (int i = (snooper->numBuckets) >> 1; i < snooper->numBuckets; i++) {
-		snooper->buckets[i] = createBucket();
+	free(old);
+}
+
+/*
+	Takes in a snooper and an entry that is not in it and copies the entry
+	into the slot that ends the probe sequence of its address. The number of
+	slots doubles first if the table would become more than half full.
+*/
+static void placeEntry(snoopy_t* snooper, snoopEntry_t* entry) {
+	if ((uint64_t) (snooper->numContents + 1) << 1 > snooper->numSlots) {
+		resizeSnooper(snooper);
 	}
-	while (frontlst) {
-		lstMover = frontlst;
-		frontlst = frontlst->next;
-		hashVal = hash(lstMover->address) & (snooper->numBuckets - 1);
-		lstMover->next = snooper->buckets[hashVal]->lst;
-		snooper->buckets[hashVal]->lst = lstMover;
+	snooper->entries[findSlot(snooper, entry->address)] = *entry;
+	snooper->numContents++;
+}
+
+/*
+	Takes in a block address and a number of stripes, which must be a power
+	of 2, and returns the stripe the block is placed in by splitSnooper.
+*/
+uint32_t snoopStripe(uint32_t address, uint32_t numStripes) {
+	// the slot in a stripe comes from the low bits of the hash
+	return (hash(address) >> 16) & (numStripes - 1);
+}
+
+/*
+	Takes in a snooper and numStripes empty snoopers and moves every entry
+	of the snooper into the stripe of its block. The snooper is left empty.
+*/
+void splitSnooper(snoopy_t* snooper, snoopy_t** stripes, uint32_t numStripes) {
+	for (uint32_t i = 0; i < snooper->numSlots; i++) {
+		snoopEntry_t* entry = &(snooper->entries[i]);
+		if (!emptySlot(entry)) {
+			placeEntry(stripes[snoopStripe(entry->address, numStripes)], entry);
+		}
 	}
+	memset(snooper->entries, 0, sizeof(snoopEntry_t) * snooper->numSlots);
+	snooper->numContents = 0;
+}
 
+/*
+	Takes in numStripes snoopers and an empty snooper and moves every entry
+	of the stripes back into the snooper. The stripes are left empty.
+*/
+void mergeSnooper(snoopy_t** stripes, uint32_t numStripes, snoopy_t* snooper) {
+	for (uint32_t i = 0; i < numStripes; i++) {
+		snoopy_t* stripe = stripes[i];
+		for (uint32_t j = 0; j < stripe->numSlots; j++) {
+			if (!emptySlot(&(stripe->entries[j]))) {
+				placeEntry(snooper, &(stripe->entries[j]));
+			}
+		}
+		memset(stripe->entries, 0, sizeof(snoopEntry_t) * stripe->numSlots);
+		stripe->numContents = 0;
+	}
 }
 
 /*
@@ -450,89 +612,70 @@ void resizeSnooper(snoopy_t* snooper) {
 	 that contains the info if it is the sole cache. Otherwise it returns -1.
 */
 int returnIDIf1(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize) {
-	int ID;
-	uint8_t count;
-	uint32_t hashVal;
-	addressList_t* lst;
 	address = address & ~(blockDataSize - 1);
-	ID = -1;
-	hashVal = hash(address) & (snooper->numBuckets - 1);
-	lst = snooper->buckets[hashVal]->lst;
-	count = 0;
-	while (lst && count < 2) {
-		if (address == lst->address) {
-			count++;
-			ID = lst->ID;
-		}
-		lst = lst->next;
+	snoopEntry_t* entry = &(snooper->entries[findSlot(snooper, address)]);
+	int count = 0;
+	for (int i = 0; i < SHARER_WORDS; i++) {
+		count += __builtin_popcountll(entry->sharers[i]);
 	}
-	return count < 2 ? ID : -1;
+	return count == 1 ? returnFirstCacheID(snooper, address, blockDataSize) : -1;
 }
 
 /*
-	Takes in a snooper, an address, and a blocksize and returns the first 
-	cache to contain the address. Returns -1 if there are none.
+	Takes in a snooper, an address, and a blocksize and returns the lowest
+	ID of a cache that contains the address. Returns -1 if there are none.
 */
 int returnFirstCacheID(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize) {
-	uint32_t hashVal;
 	address = address & ~(blockDataSize - 1);
-	hashVal = hash(address) & (snooper->numBuckets - 1);
-	addressList_t* lst = snooper->buckets[hashVal]->lst;
-	while (lst) {
-		if (address == lst->address) {
-			return lst->ID;
+	snoopEntry_t* entry = &(snooper->entries[findSlot(snooper, address)]);
+	for (int i = 0; i < SHARER_WORDS; i++) {
+		if (entry->sharers[i] != 0) {
+			return (i << 6) + __builtin_ctzll(entry->sharers[i]);
 		}
-		lst = lst->next;
 	}
 	return -1;
 }
 
 /*
-	Takes in an address and an ID and removes that list content from the table.
-	If the contents are not in the table it does nothing.
+	Takes in an address and an ID and removes the ID from the sharers of the
+	block. The entry is removed once no cache shares the block. If the
+	contents are not in the table it does nothing.
 */
 void removeFromSnooper(snoopy_t* snooper, uint32_t address, uint8_t ID, uint32_t blockDataSize) {
-	uint32_t hashVal;
 	address = address & ~(blockDataSize - 1);
-	hashVal = hash(address) & (snooper->numBuckets - 1);
-	removeItem(&(snooper->buckets[hashVal]->lst), address, ID);
-}
-
-/*
-	Takes in a pointer to a pointer to a list, an address, and an ID and removes
-	the list element from the list that matches the ID. If no element matches
-	it does nothing.
-*/
-void removeItem(addressList_t** lst, uint32_t address, uint8_t ID) {
-	if (lst == NULL || *lst == NULL) {
+	uint32_t hole = findSlot(snooper, address);
+	snoopEntry_t* entries = snooper->entries;
+	if (emptySlot(&(entries[hole]))) {
 		return;
 	}
-	addressList_t* temp = *lst;
-	if (temp->address == address && temp->ID == ID) {
-		*lst = temp->next;
-		free(temp);
-	} else {
-		return removeItem(&(temp->next), address, ID);
+	entries[hole].sharers[ID >> 6] &= ~(UINT64_C(1) << (ID & 63));
+	if (!emptySlot(&(entries[hole]))) {
+		return;
 	}
+
+	// later entries of the probe sequence move back so no probe stops early
+	uint32_t mask = snooper->numSlots - 1;
+	for (uint32_t next = (hole + 1) & mask; !emptySlot(&(entries[next])); next = (next + 1) & mask) {
+		uint32_t home = hash(entries[next].address) & mask;
+		if (((next - home) & mask) >= ((next - hole) & mask)) {
+			entries[hole] = entries[next];
+			hole = next;
+		}
+	}
+	memset(&(entries[hole]), 0, sizeof(snoopEntry_t));
+	snooper->numContents--;
 }
 
 /*
-	Decrements the LRU of every block by 1 except for the block that just
-	got invalidated which is set to the LRU max value.
+	Takes in a cache and the block number of a block that is about to be
+	invalidated. Decrements the LRU of every block above it by 1 and sets
+	the block to the LRU max value. The update is made by the on invalidate
+	hook of the replacement policy of the cache, so with a policy other
+	than LRU it does whatever that policy does instead. Does nothing if the
+	block is not valid, so it is called before the valid bit is cleared.
 */
-void decrementLRU(cache_t* cache, uint32_t tag, uint32_t idx, long oldLRU) {
-	int currLRU;
-	uint32_t blockNumber;
-	uint32_t blockNumberStart = idx << log_2(cache->n);
-	for (int i = 0; i < cache->n; i++) {
-		blockNumber = blockNumberStart + i;
-		if (tagEquals(blockNumber, tag, cache)) {
-			setLRU(cache, blockNumber, cache->n - 1);
-		} else if (getValid(cache, blockNumber)) {
-			currLRU = getLRU(cache, blockNumber);
-			if (currLRU > oldLRU) {
-			setLRU(cache, blockNumber, currLRU - 1);
-			}
-		}
+void decrementLRU(cache_t* cache, uint32_t blockNumber) {
+	if (getValid(cache, blockNumber)) {
+		cache->policy->onInvalidate(cache, blockNumber);
 	}
 }
@@ -3,7 +3,7 @@
 #define COHERENCEUTILS_H
 #include <stdbool.h>
 #include <stdint.h>
-#include "../part1/utils.h"
+#include "../cache/utils.h"
 
 /*
 	Enum used to sepcify the various allowed state in the MOESI coherence
@@ -11,6 +11,27 @@
 */
 enum state {MODIFIED, OWNED, EXCLUSIVE, SHARED, INVALID};
 
+/*
+	Struct returned by probeBlock. Holds the eviction info of the block that
+	holds the address looked up and the state of the address in the cache,
+	which is INVALID unless the block holds it. A path that fills the block
+	on a miss replaces the eviction info with the one chooseVictim returns,
+	so it can be passed to the functions that write a block.
+*/
+typedef struct probe {
+	evictionInfo_t block;
+	enum state state;
+} probeInfo_t;
+
+/*
+	Enum used to select how a cache system keeps its caches coherent.
+	SNOOP_COHERENCE checks every cache in the system against the snooper on
+	a miss. DIRECTORY_COHERENCE keeps a home entry for every cached block in
+	the snooper with the state of the block and the cache that owns it, and
+	only contacts the caches that hold the block.
+*/
+enum coherenceMode {SNOOP_COHERENCE, DIRECTORY_COHERENCE};
+
 /*
 	Struct used to contain an individual cache for a coherent system. Consists
 	of a pointer to a cache and an ID.
@@ -21,47 +42,58 @@ typedef struct cacheNode {
 } cacheNode_t;
 
 /*
-	Struct used to contain a list of all addresses and the caches in which
-	they lie. Is a linked list.
+	Number of 64 bit words in a sharer mask, enough for one bit per cache
+	ID.
 */
-typedef struct addressList {
-	uint32_t address;
-	uint8_t ID;
-	struct addressList* next;
-} addressList_t;
+#define SHARER_WORDS 4
 
 /*
-	Stuct used to represent each bucket in the snooper. Contains a pointer to
-	a list with an address.
+	Struct used to represent each slot in the snooper. Holds the address of
+	a block and a mask with the bit of every cache ID that holds the block
+	turned on, with the bit of ID 0 lowest. A slot is empty when no bit is
+	on. In a directory the state is the state of the block across the
+	system and the owner is the ID of the cache that holds it MODIFIED,
+	OWNED, or EXCLUSIVE. Neither is used by snooping.
 */
-typedef struct snoopBucket{
-	addressList_t* lst;
-} snoopBucket_t;
+typedef struct snoopEntry {
+	uint32_t address;
+	uint8_t state;
+	uint8_t owner;
+	uint64_t sharers[SHARER_WORDS];
+} snoopEntry_t;
 
 /*
-	Struct used to create the snooper for each cache. Each cache should contain
-	exactly one snooper. The buckets are used to control the actual mapping.
-	The  numContents is the number of elements in the table. If numContents
-	is twice the numBuckets the number of buckets should double. This table
-	will not dynamically shrink.
+	Struct used to create the snooper for each cache system. Each system
+	should contain exactly one snooper. The entries are an open addressing
+	table with linear probing of numSlots slots, which is always a power of
+	2, keyed by block address. The numContents is the number of blocks held
+	by at least one cache. If numContents would pass half of numSlots the
+	number of slots doubles. This table will not dynamically shrink.
 */
 typedef struct snoopy{
-	snoopBucket_t** buckets;
-	uint8_t numBuckets;
-	uint8_t numContents;
+	snoopEntry_t* entries;
+	uint32_t numSlots;
+	uint32_t numContents;
 } snoopy_t;
 
 /*
 	Struct used to contain a network of coherent caches. Consists of a
 	double pointer to cache nodes, a size of the network, and the blockDataSize
 	for the cacehe. All caches must have the same block data size and each have
-	unique IDs.
+	unique IDs, so a system holds at most 256 caches. The nodes by ID table
+	holds the node of every ID in the system and NULL for every other ID.
+	The mode selects snooping or a directory, which is kept in the snooper.
+	The locks are only set while a concurrent replay runs in a directory
+	system and are NULL otherwise.
 */
 typedef struct cacheSystem{
 	cacheNode_t** caches;
-	uint8_t size;
+	cacheNode_t* nodesByID[UINT8_MAX + 1];
+	uint32_t size;
 	uint32_t blockDataSize;
 	snoopy_t* snooper;
+	enum coherenceMode mode;
+	struct systemLocks* locks;
 } cacheSystem_t;
 
 /*
@@ -99,6 +131,38 @@ void snooperError();
 */
 void memError();
 
+/*
+	Used to indicate at least 1 cache has a victim cache, which is private
+	to its cache and is not kept coherent with the other caches.
+*/
+void victimCacheError();
+
+/*
+	Used to indicate at least 1 cache has a prefetcher, whose fills do not
+	go through the coherence protocol.
+*/
+void prefetcherError();
+
+/*
+	Used to indicate at least 1 cache is write through or does not write
+	allocate, which the MOESI states kept in the dirty and shared bits do not
+	support.
+*/
+void writePolicyError();
+
+/*
+	Used to indicate at least 1 cache is sectored. Blocks are moved between
+	caches whole, so every sector of a block would have to be valid.
+*/
+void sectorError();
+
+/*
+	Used to indicate at least 1 cache has upper levels or sits above an
+	inclusive or exclusive level. Snooping only keeps the caches in the
+	system coherent, not the blocks those levels move between each other.
+*/
+void hierarchyError();
+
 /*
 	Function that takes in a pointer to a cache and a an ID number and creates
 	a cache node. You CAN assume that the cache has already been properly
@@ -111,10 +175,23 @@ cacheNode_t* createCacheNode(cache_t* cache, uint8_t ID);
 	nodes and a size and returns a pointer to the cache system.
 	All caches must have the same block data size and no two caches can share
 	an ID. In addition all caches in a system must share the same main memory
-	source. IF any condition is failed call the appropriate error function
-	and return NULL.
+	source, which means they must hold the same physical memory backend, and
+	no cache can have a victim cache or a prefetcher or be sectored. Every
+	cache must be write back and write allocate.
+	IF any condition is failed call the appropriate error function
+	and return NULL. The system keeps its caches coherent by snooping.
+*/
+cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint32_t size, snoopy_t* snooper);
+
+/*
+	Creates a cache system in the same way as createCacheSystem but keeps
+	its caches coherent with the selected mode. A DIRECTORY_COHERENCE system
+	keeps its directory in the snooper, which must be empty. Both modes
+	count every read and write as an access of the cache that makes it and
+	as a hit only when that cache already held the block, so their hit
+	rates can be compared.
 */
-cacheSystem_t* createCacheSystem(cacheNode_t** caches, uint8_t size, snoopy_t* snooper);
+cacheSystem_t* createCacheSystemWithMode(cacheNode_t** caches, uint32_t size, snoopy_t* snooper, enum coherenceMode mode);
 
 /* 
 	Takes in a cache system and frees it and any memory any of its parts take
@@ -129,6 +206,29 @@ void deleteCacheSystem(cacheSystem_t* cacheSystem);
 */
 cache_t* getCacheFromID(cacheSystem_t* cacheSystem, uint8_t ID);
 
+/*
+	Takes in a cache and an address and looks the address up in its set
+	once without changing the replacement policy. Returns the lookup of the
+	address along with the state of the address in the cache.
+*/
+probeInfo_t probeBlock(cache_t* cache, uint32_t address);
+
+/*
+	Takes in a cache, an address that missed in the cache, the eviction info
+	of its probe, and the data of the whole block of the address, and places
+	the block in the probed block once whatever it held has been evicted.
+	The block is filled like writeToCache fills it, so it is MODIFIED
+	afterwards, but the address is not looked up again. Returns the
+	eviction info of the block, which now holds the address.
+*/
+evictionInfo_t fillProbedBlock(cache_t* cache, uint32_t address, evictionInfo_t* block, uint8_t* data);
+
+/*
+	Takes in a cache and the block number of a valid block and returns the
+	state of the block, read from its valid, dirty, and shared bits at once.
+*/
+enum state getState(cache_t* cache, uint32_t blockNumber);
+
 /*
 	Takes in a cache and an address and determines the state of the block
 	containing that address in the cache.
@@ -152,7 +252,14 @@ void setState(cache_t* cache, uint32_t blockNumber, enum state newState);
 void updateState(cache_t* cache, uint32_t address, enum state otherState);
 
 /*
-	Creates a new snooper with 8 buckets.
+	Works the same as updateState but takes the probe of the address in the
+	cache instead of looking the address up again. The probe must have been
+	made after the last change to the set of the address.
+*/
+void updateProbedState(cache_t* cache, probeInfo_t probe, enum state otherState);
+
+/*
+	Creates a new snooper with 8 slots.
 */
 snoopy_t* createSnooper();
 
@@ -162,38 +269,53 @@ snoopy_t* createSnooper();
 void deleteSnooper(snoopy_t* snooper);
 
 /*
-	Creates a bucket for the snooper.
+	Hash function used to place addresses in a snooper.
 */
-snoopBucket_t* createBucket();
+uint32_t hash(uint32_t address);
 
 /*
-	Creates a new list to keep track of IDs and addresses.
+	Adds the ID to the sharers of the block of the address. If the ID
+	already shares the block it does nothing. If the block is new and the
+	table would become more than half full the number of slots doubles
+	first.
 */
-addressList_t* createList(uint32_t address, uint8_t ID, addressList_t* next);
+void addToSnooper(snoopy_t* snooper, uint32_t address, uint8_t ID, uint32_t blockDataSize);
 
 /*
-	Hash function used to place addresses in a snooper.
+	Takes in a snooper, an address, and a block size and returns the entry
+	of the block of the address. Returns NULL if no cache holds the block.
+	The entry moves when the snooper is changed.
 */
-uint32_t hash(uint32_t address);
+snoopEntry_t* findSnoopEntry(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize);
 
 /*
-	Adds a new list to the snooper. If a list with the same address and ID is already
-	there it does nothing. Otherwise it finds its appropriate bucket for that address and
-	appends it to the front of our list. If capacity becomes twice the number of buckets
-	the number of buckets should shift.
+	Takes in a snooper, an address, and an ID. Returns true if the cache
+	with the ID shares the block at the address.
 */
-void addToSnooper(snoopy_t* snooper, uint32_t address, uint8_t ID, uint32_t blockDataSize);
+bool snooperContains(snoopy_t* snooper, uint32_t address, uint8_t ID);
 
 /*
-	Takes in a snooper, an address, and an ID. Returns true if the snooper
-	contains a list containing the address and ID.	
+	Doubles the number of slots in the snooper and places every entry again.
 */
-bool snooperContains(snoopy_t* snooper, uint32_t address, uint8_t ID);
+void resizeSnooper(snoopy_t* snooper);
 
 /*
-	Resizes the snooper if the load factor becomes >= 2.
+	Takes in a block address and a number of stripes, which must be a power
+	of 2, and returns the stripe the block is placed in by splitSnooper.
 */
-void resizeSnooper(snoopy_t* snooper);
+uint32_t snoopStripe(uint32_t address, uint32_t numStripes);
+
+/*
+	Takes in a snooper and numStripes empty snoopers and moves every entry
+	of the snooper into the stripe of its block. The snooper is left empty.
+*/
+void splitSnooper(snoopy_t* snooper, snoopy_t** stripes, uint32_t numStripes);
+
+/*
+	Takes in numStripes snoopers and an empty snooper and moves every entry
+	of the stripes back into the snooper. The stripes are left empty.
+*/
+void mergeSnooper(snoopy_t** stripes, uint32_t numStripes, snoopy_t* snooper);
 
 /*
 	Takes in a snooper, address, and block size and returns the ID of the cache
@@ -202,27 +324,25 @@ void resizeSnooper(snoopy_t* snooper);
 int returnIDIf1(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize);
 
 /*
-	Takes in a snooper, an address, and a blocksize and returns the first 
-	cache to contain the address. Returns -1 if there are none.
-*/ 
+	Takes in a snooper, an address, and a blocksize and returns the lowest
+	ID of a cache that contains the address. Returns -1 if there are none.
+*/
 int returnFirstCacheID(snoopy_t* snooper, uint32_t address, uint32_t blockDataSize);
 
 /*
-	Takes in an address and an ID and removes that list content from the table.
-	If the contents are not in the table it does nothing.
+	Takes in an address and an ID and removes the ID from the sharers of the
+	block. The entry is removed once no cache shares the block. If the
+	contents are not in the table it does nothing.
 */
 void removeFromSnooper(snoopy_t* snooper, uint32_t address, uint8_t ID, uint32_t blockDataSize);
 
 /*
-	Takes in a pointer to a pointer to a list, an address, and an ID and removes
-	the list element from the list that matches the ID. If no element matches
-	it does nothing.
-*/
-void removeItem(addressList_t** lst, uint32_t address, uint8_t ID);
-
-/*
-	Decrements the LRU of every block by 1 except for the block that just
-	got invalidated which is set to the LRU max value.
+	Takes in a cache and the block number of a block that is about to be
+	invalidated. Decrements the LRU of every block above it by 1 and sets
+	the block to the LRU max value. The update is made by the on invalidate
+	hook of the replacement policy of the cache, so with a policy other
+	than LRU it does whatever that policy does instead. Does nothing if the
+	block is not valid, so it is called before the valid bit is cleared.
 */
-void decrementLRU(cache_t* cache, uint32_t tag, uint32_t idx, long oldLRU);
+void decrementLRU(cache_t* cache, uint32_t blockNumber);
 #endif
\ No newline at end of file
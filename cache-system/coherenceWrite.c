@@ -1,11 +1,14 @@
 /* Summer 2017 */
+#include <string.h>
 #include "coherenceUtils.h"
+#include "directory.h"
 #include "coherenceWrite.h"
 #include "../cache/mem.h"
 #include "../cache/getFromCache.h"
 #include "../cache/setInCache.h"
 #include "../cache/cacheWrite.h"
 #include "../cache/cacheRead.h"
+#include "../cache/replacement.h"
 #include "../hitrate/hitRate.h"
 
 /*
@@ -15,31 +18,33 @@
 	cache being selected to write to the cache. 
 */
 void cacheSystemWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint8_t size, uint8_t* data) {
-	//uint8_t* transferData;
-	evictionInfo_t* dstCacheInfo;
-	evictionInfo_t* otherCacheInfo;
+	if (cacheSystem->mode == DIRECTORY_COHERENCE) {
+		directoryWrite(cacheSystem, address, ID, size, data);
+		return;
+	}
+	probeInfo_t dstCacheInfo;
+	probeInfo_t otherCacheInfo;
 	uint32_t evictionBlockNumber;
 	//uint32_t offset;
 	cacheNode_t** caches;
-	uint32_t tagVal;
 	//int otherCacheContains = 0;
 	cache_t* dstCache = NULL;
-	uint8_t counter = 0;
 	caches = cacheSystem->caches;
-	while (dstCache == NULL && counter < cacheSystem->size) { //Selects destination cache pointer from array of caches pointers
-		if (caches[counter]->ID == ID) {
-			dstCache = caches[counter]->cache;
-		}
-		counter++;
-	}
-	tagVal = getTag(dstCache, address);
-	dstCacheInfo = findEviction(dstCache, address); //Finds block to evict and potential match
-	evictionBlockNumber = dstCacheInfo->blockNumber;
-	if (dstCacheInfo->match) {
+	dstCache = cacheSystem->nodesByID[ID]->cache; //Selects destination cache pointer from the ID table
+	uint8_t* transferData = takeBlockBuffer(dstCache);
+	dstCacheInfo = probeBlock(dstCache, address); //Finds potential match and its state
+	if (!dstCacheInfo.block.match) {
+		dstCacheInfo.block = chooseVictim(dstCache, address); //Finds block to evict
+	}
+	evictionBlockNumber = dstCacheInfo.block.blockNumber;
+	reportAccess(dstCache);
+	if (dstCacheInfo.block.match) {
 		/*What do you do if it is in the cache?*/
 		/*Your Code Here*/
 
-		writeToCache(dstCache, address, data, size);
+		// the probe already found the block, so the write goes straight to it
+		reportHit(dstCache);
+		writeDataToCache(dstCache, address, data, size, &dstCacheInfo.block);
 		setState(dstCache, evictionBlockNumber, MODIFIED);
 		cache_t* temp;
 		for (int i = 0; i < cacheSystem->size; i++) {
@@ -56,55 +61,56 @@ void cacheSystemWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID,
 		/*How do you need to update states for what is getting evicted (don't worry about evicting this will be handled at a later step when you place data in the cache)?*/
 		/*Your Code Here*/
 		removeFromSnooper(cacheSystem->snooper, oldAddress, ID, dstCache->blockDataSize);
-		evict(dstCache, dstCacheInfo->blockNumber); //
-		setState(dstCache, dstCacheInfo->blockNumber, INVALID);
-		uint32_t oldAddrTag = getTag(dstCache, oldAddress);
-		uint32_t oldAddrIndex = getIndex(dstCache, oldAddress);
-		long oldLRU = dstCacheInfo->LRU;
-		decrementLRU(dstCache, oldAddrTag, oldAddrIndex, oldLRU);
+		evict(dstCache, evictionBlockNumber); //
+		decrementLRU(dstCache, evictionBlockNumber);
+		setState(dstCache, evictionBlockNumber, INVALID);
 
 		cache_t* temp;
 		for (int i = 0; i < cacheSystem->size; i++) {
 			if (caches[i]->ID != ID && snooperContains(cacheSystem->snooper, oldAddress, caches[i]->ID)) {
 				temp = caches[i]->cache;
-				if (determineState(temp, oldAddress) == SHARED && returnIDIf1(cacheSystem->snooper, oldAddress, cacheSystem->blockDataSize)) {
+				probeInfo_t tempInfo = probeBlock(temp, oldAddress);
+				if (tempInfo.state == SHARED && returnIDIf1(cacheSystem->snooper, oldAddress, cacheSystem->blockDataSize)) {
 					continue;
 				}
-				updateState(temp, oldAddress, INVALID);
+				updateProbedState(temp, tempInfo, INVALID);
 			}
 		}
 
 		int val = returnFirstCacheID(cacheSystem->snooper, address, cacheSystem->blockDataSize);
+		bool filled = false;
 		/*Check other caches???*/
 		while(val != -1) {
-			cache_t* other;
-			for (int i = 0; i < cacheSystem->size; i++) {
-				if (caches[i]->ID == val) {
-					other = caches[i]->cache;
-					break;
-				}
-			}
-			otherCacheInfo = findEviction(other, address);
-			enum state otherState = determineState(other, address);
+			cache_t* other = cacheSystem->nodesByID[val]->cache;
+			otherCacheInfo = probeBlock(other, address);
+			enum state otherState = otherCacheInfo.state;
 			if (otherState == MODIFIED) {
-				uint32_t addr = extractAddress(other, getTag(other, address), otherCacheInfo->blockNumber, 0);
-				uint8_t* retVal = readFromCache(other, addr, other->blockDataSize);
-				writeToCache(dstCache, addr, retVal, other->blockDataSize);
-				free(retVal);
-				free(otherCacheInfo);
+				fetchBlockInto(other, otherCacheInfo.block.blockNumber, transferData);
+				other->policy->onHit(other, otherCacheInfo.block.blockNumber);
+				dstCacheInfo.block = fillProbedBlock(dstCache, address, &dstCacheInfo.block, transferData);
+				filled = true;
 				break;
 			} else {
 				removeFromSnooper(cacheSystem->snooper, address, val, cacheSystem->blockDataSize);
-				setState(other, otherCacheInfo->blockNumber, INVALID);
-				uint32_t addrTag = getTag(other, address);
-				uint32_t addrIndex = getIndex(other, address);
-				long oldLRU = otherCacheInfo->LRU;
-				decrementLRU(other, addrTag, addrIndex, oldLRU);
-				free(otherCacheInfo);
+
+				// a cache the snooper lists may have dropped the block already
+				if (otherCacheInfo.block.match) {
+					decrementLRU(other, otherCacheInfo.block.blockNumber);
+					setState(other, otherCacheInfo.block.blockNumber, INVALID);
+				}
 			}
 			val = returnFirstCacheID(cacheSystem->snooper, address, cacheSystem->blockDataSize);
 		}
-		writeToCache(dstCache, address, data, size);
+
+		// the write goes to the probed block, so the set is not looked up again
+		if (filled) {
+			writeDataToCache(dstCache, address, data, size, &dstCacheInfo.block);
+		} else {
+			uint32_t offset = getOffset(dstCache, address);
+			readFromMemInto(dstCache, address - offset, transferData);
+			memcpy(transferData + offset, data, size);
+			fillProbedBlock(dstCache, address, &dstCacheInfo.block, transferData);
+		}
 		setState(dstCache, evictionBlockNumber, MODIFIED);
 		for (int i = 0; i < cacheSystem->size; i++) {
 			if (caches[i]->ID != ID) {
@@ -115,7 +121,7 @@ void cacheSystemWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID,
 		}
 	}
 	addToSnooper(cacheSystem->snooper, address, ID, cacheSystem->blockDataSize);
-	free(dstCacheInfo);
+	releaseBlockBuffer(cacheSystem->nodesByID[ID]->cache);
 }
 
 
@@ -130,15 +136,7 @@ int cacheSystemByteWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 	if (!cacheSystem) {
 		return -1;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		return -1;
 	}
 
@@ -163,15 +161,7 @@ int cacheSystemHalfWordWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8
 	if (!cacheSystem) {
 		return -1;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		return -1;
 	}
 
@@ -201,15 +191,7 @@ int cacheSystemWordWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t I
 	if (!cacheSystem) {
 		return -1;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		return -1;
 	}
 
@@ -241,15 +223,7 @@ int cacheSystemDoubleWordWrite(cacheSystem_t* cacheSystem, uint32_t address, uin
 	if (!cacheSystem) {
 		return -1;
 	}
-	bool realID = false;
-	cacheNode_t** caches = cacheSystem->caches;
-	for (int i = 0; i < cacheSystem->size; i++) {
-		if (caches[i]->ID == ID) {
-			realID = true;
-			break;
-		}
-	}
-	if (!realID) {
+	if (cacheSystem->nodesByID[ID] == NULL) {
 		return -1;
 	}
 
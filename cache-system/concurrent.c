@@ -0,0 +1,366 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <pthread.h>
+#include "coherenceUtils.h"
+#include "coherenceRead.h"
+#include "coherenceWrite.h"
+#include "concurrent.h"
+#include "../cache/utils.h"
+#include "../cache/memBackend.h"
+
+/*
+	Struct used to hold the state every thread of a replay shares. The lock
+	guards the turn, which is the index of the thread that makes the next
+	access in a deterministic replay, and the positions of the threads. In
+	a snooping replay that is not deterministic it is held for every
+	access instead. Stop is set if not every thread could be started.
+*/
+typedef struct replay {
+	cacheSystem_t* cacheSystem;
+	pthread_mutex_t lock;
+	struct replayer* replayers;
+	uint32_t numReplayers;
+	uint32_t turn;
+	bool deterministic;
+	bool serial;
+	bool stop;
+} replay_t;
+
+/*
+	Struct used to hand a trace to the thread that replays it. The position
+	is the index of the next access of the trace and the thread waits on
+	its condition for its turn.
+*/
+typedef struct replayer {
+	replay_t* replay;
+	coreTrace_t* trace;
+	uint32_t index;
+	uint32_t position;
+	pthread_cond_t turn;
+} replayer_t;
+
+/*
+	Used to indicate that a cache system cannot be replayed concurrently
+	because its physical memory cannot be accessed by several threads at
+	once.
+*/
+void concurrentBackendError() {
+	fprintf(stderr, "\nError: Concurrent replay needs a binary, mmap, or arena backend\n");
+}
+
+/*
+	Takes in a cache system and a block address and returns the snooper
+	that holds the directory entry of the block. This is the snooper of the
+	system unless a concurrent replay has split it into stripes.
+*/
+snoopy_t* snooperOf(cacheSystem_t* cacheSystem, uint32_t address) {
+	systemLocks_t* locks = cacheSystem->locks;
+	if (locks == NULL) {
+		return cacheSystem->snooper;
+	}
+	address = address & ~(cacheSystem->blockDataSize - 1);
+	return locks->stripes[snoopStripe(address, locks->numStripes)];
+}
+
+/*
+	Takes in a cache system and an ID and locks the cache with the ID if a
+	concurrent replay is running. Does nothing otherwise.
+*/
+void lockCacheOf(cacheSystem_t* cacheSystem, uint8_t ID) {
+	if (cacheSystem->locks != NULL) {
+		pthread_mutex_lock(&(cacheSystem->locks->cacheLocks[ID]));
+	}
+}
+
+/*
+	Takes in a cache system and an ID and unlocks the cache locked by
+	lockCacheOf.
+*/
+void unlockCacheOf(cacheSystem_t* cacheSystem, uint8_t ID) {
+	if (cacheSystem->locks != NULL) {
+		pthread_mutex_unlock(&(cacheSystem->locks->cacheLocks[ID]));
+	}
+}
+
+/*
+	Takes in a cache system and two block addresses and returns the stripes
+	of the blocks through low and high, with the lower stripe in low.
+*/
+static void findStripes(cacheSystem_t* cacheSystem, uint32_t first, uint32_t second, uint32_t* low, uint32_t* high) {
+	uint32_t mask = ~(cacheSystem->blockDataSize - 1);
+	uint32_t a = snoopStripe(first & mask, cacheSystem->locks->numStripes);
+	uint32_t b = snoopStripe(second & mask, cacheSystem->locks->numStripes);
+	*low = a < b ? a : b;
+	*high = a < b ? b : a;
+}
+
+/*
+	Takes in a cache system and two block addresses, which may be the same,
+	and locks the stripes that hold both if a concurrent replay is running.
+	Stripes are locked in ascending order so two threads cannot wait on
+	each other. Does nothing otherwise.
+*/
+void lockBlocks(cacheSystem_t* cacheSystem, uint32_t first, uint32_t second) {
+	if (cacheSystem->locks == NULL) {
+		return;
+	}
+	uint32_t low, high;
+	findStripes(cacheSystem, first, second, &low, &high);
+	pthread_mutex_lock(&(cacheSystem->locks->stripeLocks[low]));
+	if (high != low) {
+		pthread_mutex_lock(&(cacheSystem->locks->stripeLocks[high]));
+	}
+}
+
+/*
+	Takes in a cache system and the two block addresses passed to
+	lockBlocks and unlocks their stripes.
+*/
+void unlockBlocks(cacheSystem_t* cacheSystem, uint32_t first, uint32_t second) {
+	if (cacheSystem->locks == NULL) {
+		return;
+	}
+	uint32_t low, high;
+	findStripes(cacheSystem, first, second, &low, &high);
+	if (high != low) {
+		pthread_mutex_unlock(&(cacheSystem->locks->stripeLocks[high]));
+	}
+	pthread_mutex_unlock(&(cacheSystem->locks->stripeLocks[low]));
+}
+
+/*
+	Takes in a directory system and creates its locks, moving its directory
+	into the stripes. The locks are installed in the system.
+*/
+static void createLocks(cacheSystem_t* cacheSystem) {
+	systemLocks_t* locks = malloc(sizeof(systemLocks_t));
+	if (locks == NULL) {
+		allocationFailed();
+	}
+	locks->numStripes = LOCK_STRIPES;
+	locks->stripes = malloc(sizeof(snoopy_t*) * LOCK_STRIPES);
+	locks->stripeLocks = malloc(sizeof(pthread_mutex_t) * LOCK_STRIPES);
+	if (locks->stripes == NULL || locks->stripeLocks == NULL) {
+		allocationFailed();
+	}
+	for (uint32_t i = 0; i < LOCK_STRIPES; i++) {
+		locks->stripes[i] = createSnooper();
+		pthread_mutex_init(&(locks->stripeLocks[i]), NULL);
+	}
+	for (uint32_t i = 0; i < cacheSystem->size; i++) {
+		pthread_mutex_init(&(locks->cacheLocks[cacheSystem->caches[i]->ID]), NULL);
+	}
+	splitSnooper(cacheSystem->snooper, locks->stripes, locks->numStripes);
+	cacheSystem->locks = locks;
+}
+
+/*
+	Takes in a directory system with locks and moves its directory back
+	into its snooper before freeing the locks.
+*/
+static void deleteLocks(cacheSystem_t* cacheSystem) {
+	systemLocks_t* locks = cacheSystem->locks;
+	cacheSystem->locks = NULL;
+	mergeSnooper(locks->stripes, locks->numStripes, cacheSystem->snooper);
+	for (uint32_t i = 0; i < locks->numStripes; i++) {
+		deleteSnooper(locks->stripes[i]);
+		pthread_mutex_destroy(&(locks->stripeLocks[i]));
+	}
+	for (uint32_t i = 0; i < cacheSystem->size; i++) {
+		pthread_mutex_destroy(&(locks->cacheLocks[cacheSystem->caches[i]->ID]));
+	}
+	free(locks->stripes);
+	free(locks->stripeLocks);
+	free(locks);
+}
+
+/*
+	Takes in a cache system, an ID, and an access and makes the access
+	through the cache with the ID. A read that succeeds puts the value it
+	read in the access.
+*/
+static void makeAccess(cacheSystem_t* cacheSystem, uint8_t ID, coreAccess_t* access) {
+	uint32_t address = access->address;
+	if (access->write) {
+		if (access->size == 1) {
+			cacheSystemByteWrite(cacheSystem, address, ID, (uint8_t) access->data);
+		} else if (access->size == 2) {
+			cacheSystemHalfWordWrite(cacheSystem, address, ID, (uint16_t) access->data);
+		} else if (access->size == 4) {
+			cacheSystemWordWrite(cacheSystem, address, ID, (uint32_t) access->data);
+		} else if (access->size == 8) {
+			cacheSystemDoubleWordWrite(cacheSystem, address, ID, access->data);
+		}
+	} else if (access->size == 1) {
+		byteInfo_t info = cacheSystemByteRead(cacheSystem, address, ID);
+		if (info.success) {
+			access->data = info.data;
+		}
+	} else if (access->size == 2) {
+		halfWordInfo_t info = cacheSystemHalfWordRead(cacheSystem, address, ID);
+		if (info.success) {
+			access->data = info.data;
+		}
+	} else if (access->size == 4) {
+		wordInfo_t info = cacheSystemWordRead(cacheSystem, address, ID);
+		if (info.success) {
+			access->data = info.data;
+		}
+	} else if (access->size == 8) {
+		doubleWordInfo_t info = cacheSystemDoubleWordRead(cacheSystem, address, ID);
+		if (info.success) {
+			access->data = info.data;
+		}
+	}
+}
+
+/*
+	Takes in a replay and the index of the thread that just made an access
+	and passes the turn to the next thread in round robin order that has an
+	access left. Must be called with the lock of the replay held.
+*/
+static void passTurn(replay_t* replay, uint32_t index) {
+	for (uint32_t i = 1; i <= replay->numReplayers; i++) {
+		replayer_t* next = &(replay->replayers[(index + i) % replay->numReplayers]);
+		if (next->position < next->trace->length) {
+			replay->turn = next->index;
+			pthread_cond_signal(&(next->turn));
+			return;
+		}
+	}
+}
+
+/*
+	Start routine of the thread of a replayer. Makes every access of its
+	trace, taking turns with the other threads if the replay is
+	deterministic.
+*/
+static void* replayTrace(void* arg) {
+	replayer_t* replayer = (replayer_t*) arg;
+	replay_t* replay = replayer->replay;
+	coreTrace_t* trace = replayer->trace;
+
+	// every thread waits until all of them were started
+	pthread_mutex_lock(&(replay->lock));
+	bool stop = replay->stop;
+	pthread_mutex_unlock(&(replay->lock));
+	if (stop) {
+		return NULL;
+	}
+	for (uint32_t i = 0; i < trace->length; i++) {
+		if (replay->deterministic) {
+			pthread_mutex_lock(&(replay->lock));
+			while (replay->turn != replayer->index) {
+				pthread_cond_wait(&(replayer->turn), &(replay->lock));
+			}
+			pthread_mutex_unlock(&(replay->lock));
+		} else if (replay->serial) {
+			pthread_mutex_lock(&(replay->lock));
+		}
+		makeAccess(replay->cacheSystem, trace->ID, &(trace->accesses[i]));
+		if (replay->deterministic) {
+			pthread_mutex_lock(&(replay->lock));
+			replayer->position = i + 1;
+			passTurn(replay, replayer->index);
+			pthread_mutex_unlock(&(replay->lock));
+		} else if (replay->serial) {
+			pthread_mutex_unlock(&(replay->lock));
+		}
+	}
+	return NULL;
+}
+
+/*
+	Takes in a cache system and one trace per core and replays every trace
+	on its own thread, each making its accesses in order through the cache
+	with the ID of the trace. No two traces can have the same ID and every
+	ID must be in the system.
+
+	If deterministic is set the threads take turns so the accesses are made
+	in round robin order: the first access of every trace in the order the
+	traces are given, then the second, and so on, skipping traces that have
+	ended. The results are the same as making the accesses in that order
+	from one thread, but no two accesses run at once.
+
+	Otherwise the accesses of different cores run at the same time. In a
+	DIRECTORY_COHERENCE system hits only lock the cache that hits and a
+	miss or a write that needs the directory locks the stripes of the
+	block and of the block it replaces, so accesses to different blocks do
+	not wait for each other. The physical memory must then be a
+	BINARY_BACKEND, MMAP_BACKEND, or ARENA_BACKEND. A snooping system sends
+	every miss to every cache, so its accesses are made one at a time in
+	whatever order the threads reach them.
+
+	Returns -1 if the traces are invalid, the physical memory cannot be
+	shared by the threads, or a thread cannot be started, and otherwise 0
+	once every trace has been replayed.
+*/
+int replayCacheSystem(cacheSystem_t* cacheSystem, coreTrace_t* traces, uint32_t numTraces, bool deterministic) {
+	if (cacheSystem == NULL || (traces == NULL && numTraces != 0)) {
+		return -1;
+	}
+	bool seen[UINT8_MAX + 1] = {false};
+	for (uint32_t i = 0; i < numTraces; i++) {
+		uint8_t ID = traces[i].ID;
+		if (cacheSystem->nodesByID[ID] == NULL || seen[ID] || (traces[i].accesses == NULL && traces[i].length != 0)) {
+			return -1;
+		}
+		seen[ID] = true;
+	}
+	if (numTraces == 0) {
+		return 0;
+	}
+	bool striped = !deterministic && cacheSystem->mode == DIRECTORY_COHERENCE;
+	if (striped) {
+		enum memBackendType type = cacheSystem->caches[0]->cache->backend->type;
+		if (type != BINARY_BACKEND && type != MMAP_BACKEND && type != ARENA_BACKEND) {
+			concurrentBackendError();
+			return -1;
+		}
+		createLocks(cacheSystem);
+	}
+
+	replay_t replay;
+	replayer_t replayers[numTraces];
+	pthread_t threads[numTraces];
+	replay.cacheSystem = cacheSystem;
+	replay.replayers = replayers;
+	replay.numReplayers = numTraces;
+	replay.turn = numTraces;
+	replay.deterministic = deterministic;
+	replay.serial = !deterministic && !striped;
+	replay.stop = false;
+	pthread_mutex_init(&(replay.lock), NULL);
+	for (uint32_t i = 0; i < numTraces; i++) {
+		replayers[i].replay = &replay;
+		replayers[i].trace = &(traces[i]);
+		replayers[i].index = i;
+		replayers[i].position = 0;
+		pthread_cond_init(&(replayers[i].turn), NULL);
+	}
+
+	// the turn starts at the last trace so the first trace with an access goes first
+	pthread_mutex_lock(&(replay.lock));
+	passTurn(&replay, numTraces - 1);
+	uint32_t started = 0;
+	while (started < numTraces && pthread_create(&(threads[started]), NULL, replayTrace, &(replayers[started])) == 0) {
+		started++;
+	}
+	replay.stop = started < numTraces;
+	pthread_mutex_unlock(&(replay.lock));
+	for (uint32_t i = 0; i < started; i++) {
+		pthread_join(threads[i], NULL);
+	}
+
+	for (uint32_t i = 0; i < numTraces; i++) {
+		pthread_cond_destroy(&(replayers[i].turn));
+	}
+	pthread_mutex_destroy(&(replay.lock));
+	if (striped) {
+		deleteLocks(cacheSystem);
+	}
+	return replay.stop ? -1 : 0;
+}
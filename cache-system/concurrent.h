@@ -0,0 +1,119 @@
+/* Summer 2017 */
+#ifndef CONCURRENT_H
+#define CONCURRENT_H
+#include <pthread.h>
+
+/*
+	Number of stripes the directory of a cache system is split into while a
+	concurrent replay runs. Must be a power of 2.
+*/
+#define LOCK_STRIPES 256
+
+/*
+	Struct used to describe one access in the trace of a core. The size is
+	1, 2, 4, or 8 bytes. A write stores the rightmost size bytes of data and
+	a read puts the value it read in data. Accesses to invalid or misaligned
+	addresses are skipped like they are by the functions that read and
+	write a cache system.
+*/
+typedef struct coreAccess {
+	uint32_t address;
+	uint8_t size;
+	bool write;
+	uint64_t data;
+} coreAccess_t;
+
+/*
+	Struct used to hold the trace of one core. The accesses are made in
+	order by the cache with the ID.
+*/
+typedef struct coreTrace {
+	uint8_t ID;
+	coreAccess_t* accesses;
+	uint32_t length;
+} coreTrace_t;
+
+/*
+	Struct used to hold the locks of a cache system while a concurrent
+	replay runs in a DIRECTORY_COHERENCE system. The directory is split
+	into numStripes snoopers by block address and each has its own lock,
+	which is held while the coherence state of any of its blocks changes.
+	Every cache has a lock, found by its ID, which is held while the cache
+	is read or changed. A thread that holds a cache lock never waits for a
+	stripe and never holds two cache locks.
+*/
+typedef struct systemLocks {
+	snoopy_t** stripes;
+	pthread_mutex_t* stripeLocks;
+	uint32_t numStripes;
+	pthread_mutex_t cacheLocks[UINT8_MAX + 1];
+} systemLocks_t;
+
+/*
+	Used to indicate that a cache system cannot be replayed concurrently
+	because its physical memory cannot be accessed by several threads at
+	once.
+*/
+void concurrentBackendError();
+
+/*
+	Takes in a cache system and a block address and returns the snooper
+	that holds the directory entry of the block. This is the snooper of the
+	system unless a concurrent replay has split it into stripes.
+*/
+snoopy_t* snooperOf(cacheSystem_t* cacheSystem, uint32_t address);
+
+/*
+	Takes in a cache system and an ID and locks the cache with the ID if a
+	concurrent replay is running. Does nothing otherwise.
+*/
+void lockCacheOf(cacheSystem_t* cacheSystem, uint8_t ID);
+
+/*
+	Takes in a cache system and an ID and unlocks the cache locked by
+	lockCacheOf.
+*/
+void unlockCacheOf(cacheSystem_t* cacheSystem, uint8_t ID);
+
+/*
+	Takes in a cache system and two block addresses, which may be the same,
+	and locks the stripes that hold both if a concurrent replay is running.
+	Stripes are locked in ascending order so two threads cannot wait on
+	each other. Does nothing otherwise.
+*/
+void lockBlocks(cacheSystem_t* cacheSystem, uint32_t first, uint32_t second);
+
+/*
+	Takes in a cache system and the two block addresses passed to
+	lockBlocks and unlocks their stripes.
+*/
+void unlockBlocks(cacheSystem_t* cacheSystem, uint32_t first, uint32_t second);
+
+/*
+	Takes in a cache system and one trace per core and replays every trace
+	on its own thread, each making its accesses in order through the cache
+	with the ID of the trace. No two traces can have the same ID and every
+	ID must be in the system.
+
+	If deterministic is set the threads take turns so the accesses are made
+	in round robin order: the first access of every trace in the order the
+	traces are given, then the second, and so on, skipping traces that have
+	ended. The results are the same as making the accesses in that order
+	from one thread, but no two accesses run at once.
+
+	Otherwise the accesses of different cores run at the same time. In a
+	DIRECTORY_COHERENCE system hits only lock the cache that hits and a
+	miss or a write that needs the directory locks the stripes of the
+	block and of the block it replaces, so accesses to different blocks do
+	not wait for each other. The physical memory must then be a
+	BINARY_BACKEND, MMAP_BACKEND, or ARENA_BACKEND. A snooping system sends
+	every miss to every cache, so its accesses are made one at a time in
+	whatever order the threads reach them.
+
+	Returns -1 if the traces are invalid, the physical memory cannot be
+	shared by the threads, or a thread cannot be started, and otherwise 0
+	once every trace has been replayed.
+*/
+int replayCacheSystem(cacheSystem_t* cacheSystem, coreTrace_t* traces, uint32_t numTraces, bool deterministic);
+
+#endif
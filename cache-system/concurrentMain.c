@@ -0,0 +1,265 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../cache/utils.h"
+#include "../cache/mem.h"
+#include "../cache/memBackend.h"
+#include "../cache/setInCache.h"
+#include "coherenceUtils.h"
+#include "coherenceRead.h"
+#include "coherenceWrite.h"
+#include "concurrent.h"
+
+#define NUM_CORES 8
+#define TRACE_LENGTH 4000
+#define SHADOW_SIZE (4096 + 8)
+
+static uint64_t state = 88172645463325252ULL;
+
+/*
+	Returns the next number of a xorshift generator so every run makes the
+	same traces.
+*/
+static uint64_t nextRandom() {
+	state ^= state << 13;
+	state ^= state >> 7;
+	state ^= state << 17;
+	return state;
+}
+
+/*
+	Takes in an arena, a coherence mode, and a replacement policy and makes
+	a system of NUM_CORES small caches on the arena.
+*/
+static cacheSystem_t* createSystem(memBackend_t* memory, enum coherenceMode mode, enum replacement replacement) {
+	cacheNode_t** caches = malloc(sizeof(cacheNode_t*) * NUM_CORES);
+	for (uint8_t i = 0; i < NUM_CORES; i++) {
+		cacheOptions_t options = defaultCacheOptions();
+		options.backend = memory;
+		options.replacement = replacement;
+		caches[i] = createCacheNode(createCacheWithOptions(2, 16, 512, NULL, &options), 3 * i + 1);
+	}
+	return createCacheSystemWithMode(caches, NUM_CORES, createSnooper(), mode);
+}
+
+/*
+	Makes one trace per core. If owned is set every core only accesses the
+	bytes whose address is its index modulo NUM_CORES, one byte at a time,
+	so the values it reads and the final contents of memory do not depend
+	on the order the cores run in. Otherwise the cores make accesses of
+	every size anywhere in a shared range of memory.
+*/
+static coreTrace_t* createTraces(bool owned) {
+	coreTrace_t* traces = malloc(sizeof(coreTrace_t) * NUM_CORES);
+	for (uint8_t c = 0; c < NUM_CORES; c++) {
+		traces[c].ID = 3 * c + 1;
+		traces[c].length = TRACE_LENGTH - (c % 3) * 17;
+		traces[c].accesses = malloc(sizeof(coreAccess_t) * traces[c].length);
+		for (uint32_t i = 0; i < traces[c].length; i++) {
+			coreAccess_t* access = &(traces[c].accesses[i]);
+			uint32_t offset = nextRandom() % 4096;
+			access->size = owned ? 1 : 1 << (nextRandom() % 4);
+			access->address = owned ? MIN_ADDRESS + (offset & ~(NUM_CORES - 1u)) + c
+				: (MIN_ADDRESS + offset) & ~(access->size - 1u);
+			access->write = nextRandom() % 3 == 0;
+			access->data = nextRandom();
+		}
+	}
+	return traces;
+}
+
+/*
+	Returns a copy of the traces so the values read by two replays can be
+	compared.
+*/
+static coreTrace_t* copyTraces(coreTrace_t* traces) {
+	coreTrace_t* copy = malloc(sizeof(coreTrace_t) * NUM_CORES);
+	for (uint8_t c = 0; c < NUM_CORES; c++) {
+		copy[c] = traces[c];
+		copy[c].accesses = malloc(sizeof(coreAccess_t) * traces[c].length);
+		memcpy(copy[c].accesses, traces[c].accesses, sizeof(coreAccess_t) * traces[c].length);
+	}
+	return copy;
+}
+
+static void deleteTraces(coreTrace_t* traces) {
+	for (uint8_t c = 0; c < NUM_CORES; c++) {
+		free(traces[c].accesses);
+	}
+	free(traces);
+}
+
+/*
+	Makes the accesses of the traces from this thread in the round robin
+	order a deterministic replay uses.
+*/
+static void replaySerially(cacheSystem_t* cacheSystem, coreTrace_t* traces) {
+	bool active = true;
+	for (uint32_t i = 0; active; i++) {
+		active = false;
+		for (uint8_t c = 0; c < NUM_CORES; c++) {
+			if (i >= traces[c].length) {
+				continue;
+			}
+			active = true;
+			coreAccess_t* access = &(traces[c].accesses[i]);
+			uint8_t ID = traces[c].ID;
+			if (access->write) {
+				if (access->size == 1) {
+					cacheSystemByteWrite(cacheSystem, access->address, ID, (uint8_t) access->data);
+				} else if (access->size == 2) {
+					cacheSystemHalfWordWrite(cacheSystem, access->address, ID, (uint16_t) access->data);
+				} else if (access->size == 4) {
+					cacheSystemWordWrite(cacheSystem, access->address, ID, (uint32_t) access->data);
+				} else {
+					cacheSystemDoubleWordWrite(cacheSystem, access->address, ID, access->data);
+				}
+			} else if (access->size == 1) {
+				access->data = cacheSystemByteRead(cacheSystem, access->address, ID).data;
+			} else if (access->size == 2) {
+				access->data = cacheSystemHalfWordRead(cacheSystem, access->address, ID).data;
+			} else if (access->size == 4) {
+				access->data = cacheSystemWordRead(cacheSystem, access->address, ID).data;
+			} else {
+				access->data = cacheSystemDoubleWordRead(cacheSystem, access->address, ID).data;
+			}
+		}
+	}
+}
+
+/*
+	Takes in a threaded and a serial replay of the same traces and returns
+	the number of ways they differ: the values each trace read, the hits of
+	each cache if compareHits is set, and physical memory once every cache
+	has written its dirty blocks back.
+*/
+static long compareReplays(cacheSystem_t* threaded, cacheSystem_t* serial, coreTrace_t* threadedTraces,
+	coreTrace_t* serialTraces, memBackend_t* threadedMemory, memBackend_t* serialMemory, bool compareHits) {
+	long differences = 0;
+	for (uint8_t c = 0; c < NUM_CORES; c++) {
+		if (memcmp(threadedTraces[c].accesses, serialTraces[c].accesses, sizeof(coreAccess_t) * serialTraces[c].length)) {
+			differences++;
+		}
+		cache_t* threadedCache = threaded->caches[c]->cache;
+		cache_t* serialCache = serial->caches[c]->cache;
+		if (compareHits && (threadedCache->hit != serialCache->hit || threadedCache->access != serialCache->access)) {
+			differences++;
+		}
+		contextSwitch(threadedCache);
+		contextSwitch(serialCache);
+	}
+	if (memcmp(threadedMemory->memory, serialMemory->memory, MEMORY_SIZE)) {
+		differences++;
+	}
+	return differences;
+}
+
+/*
+	Takes in traces that have been replayed and the arena they were replayed
+	on, after every cache has written its dirty blocks back, and returns the
+	number of ways the replay differs from a shadow copy of memory that
+	makes the same accesses in the round robin order of a deterministic
+	replay: the values each trace read and the bytes the traces can reach.
+	Values are stored with their most significant byte at the lowest
+	address, like the caches store them.
+*/
+static long compareShadow(coreTrace_t* traces, memBackend_t* memory) {
+	static uint8_t shadow[SHADOW_SIZE];
+	long differences = 0;
+	bool active = true;
+	memset(shadow, 0, SHADOW_SIZE);
+	for (uint32_t i = 0; active; i++) {
+		active = false;
+		for (uint8_t c = 0; c < NUM_CORES; c++) {
+			if (i >= traces[c].length) {
+				continue;
+			}
+			active = true;
+			coreAccess_t* access = &(traces[c].accesses[i]);
+			uint32_t offset = access->address - MIN_ADDRESS;
+			if (access->write) {
+				uint64_t data = access->data;
+				for (int b = access->size - 1; b >= 0; b--) {
+					shadow[offset + b] = (uint8_t) data;
+					data >>= 8;
+				}
+			} else {
+				uint64_t value = 0;
+				for (uint8_t b = 0; b < access->size; b++) {
+					value = (value << 8) | shadow[offset + b];
+				}
+				if (value != access->data) {
+					differences++;
+				}
+			}
+		}
+	}
+	if (memcmp(memory->memory, shadow, SHADOW_SIZE)) {
+		differences++;
+	}
+	return differences;
+}
+
+/*
+	Checks that replaying traces on threads gives the same results as making
+	the accesses from one thread. The threaded replays run first so the
+	first use of everything that is set up lazily happens on several
+	threads at once.
+
+	A deterministic replay of traces that share memory must match the
+	serial round robin order exactly, including every hit, in both
+	coherence modes. A concurrent replay of a directory system where every
+	core only touches its own bytes must read the same values and leave the
+	same memory as the serial order. Every directory replay is also checked
+	against a shadow copy of memory. Snooping systems are only compared
+	with the serial order: they do not match the shadow memory even from
+	one thread, so the values a concurrent snooping replay reads depend on
+	the order the cores run in. Returns 1 if any replay differs.
+*/
+int main() {
+	enum replacement policies[] = {LRU_REPLACEMENT, RANDOM_REPLACEMENT, SRRIP_REPLACEMENT};
+	long differences = 0;
+
+	for (int concurrent = 1; concurrent >= 0; concurrent--) {
+		for (int mode = concurrent ? DIRECTORY_COHERENCE : SNOOP_COHERENCE; mode <= DIRECTORY_COHERENCE; mode++) {
+			for (unsigned int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+				memBackend_t* threadedMemory = createArenaBackend();
+				memBackend_t* serialMemory = createArenaBackend();
+				cacheSystem_t* threaded = createSystem(threadedMemory, mode, policies[p]);
+				cacheSystem_t* serial = createSystem(serialMemory, mode, policies[p]);
+				coreTrace_t* threadedTraces = createTraces(concurrent);
+				coreTrace_t* serialTraces = copyTraces(threadedTraces);
+
+				long replayDifferences = 0;
+				if (replayCacheSystem(threaded, threadedTraces, NUM_CORES, !concurrent) == -1) {
+					replayDifferences++;
+				}
+				replaySerially(serial, serialTraces);
+				replayDifferences += compareReplays(threaded, serial, threadedTraces, serialTraces, threadedMemory,
+					serialMemory, !concurrent);
+				if (replayDifferences != 0) {
+					printf("%s replay differs from serial: mode %d policy %u\n",
+						concurrent ? "Concurrent" : "Deterministic", mode, p);
+				}
+				long shadowDifferences = mode == DIRECTORY_COHERENCE ? compareShadow(threadedTraces, threadedMemory) : 0;
+				if (shadowDifferences != 0) {
+					printf("%s replay differs from shadow memory: mode %d policy %u differences %ld\n",
+						concurrent ? "Concurrent" : "Deterministic", mode, p, shadowDifferences);
+				}
+				differences += replayDifferences + shadowDifferences;
+
+				deleteTraces(threadedTraces);
+				deleteTraces(serialTraces);
+				deleteCacheSystem(threaded);
+				deleteCacheSystem(serial);
+				releaseMemBackend(threadedMemory);
+				releaseMemBackend(serialMemory);
+			}
+		}
+	}
+	printf("%ld differences from serial replays and shadow memory\n", differences);
+	return differences != 0;
+}
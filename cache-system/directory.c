@@ -0,0 +1,266 @@
+/* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "coherenceUtils.h"
+#include "directory.h"
+#include "concurrent.h"
+#include "../cache/utils.h"
+#include "../cache/setInCache.h"
+#include "../cache/getFromCache.h"
+#include "../cache/cacheRead.h"
+#include "../cache/cacheWrite.h"
+#include "../cache/mem.h"
+#include "../cache/replacement.h"
+#include "../hitrate/hitRate.h"
+
+/*
+	Takes in a cache and the block number of a copy that is being removed
+	from it and invalidates the copy without writing it back.
+*/
+static void invalidateCopy(cache_t* cache, uint32_t blockNumber) {
+	setState(cache, blockNumber, INVALID);
+	cache->policy->onInvalidate(cache, blockNumber);
+}
+
+/*
+	Takes in a cache, the block number of an invalid block, the address of
+	the block that is placed in it, the data of the whole block, and the
+	state the block gets and fills the block.
+*/
+static void fillBlock(cache_t* cache, uint32_t blockNumber, uint32_t address, uint8_t* data, enum state state) {
+	setTag(cache, getTag(cache, address), blockNumber);
+	setData(cache, data, blockNumber, cache->blockDataSize, 0);
+	setState(cache, blockNumber, state);
+	cache->policy->onFill(cache, blockNumber);
+}
+
+/*
+	Takes in a cache, a block number, and a block address and returns
+	whether the block holds the block address.
+*/
+static bool holdsBlock(cache_t* cache, uint32_t blockNumber, uint32_t address) {
+	return getValid(cache, blockNumber) && tagEquals(blockNumber, getTag(cache, address), cache);
+}
+
+/*
+	Takes in a cache and the block number of a block that is about to be
+	replaced and returns the address of the block it holds, or the address
+	passed in if it holds nothing.
+*/
+static uint32_t replacedAddress(cache_t* cache, uint32_t blockNumber, uint32_t address) {
+	if (!getValid(cache, blockNumber)) {
+		return address;
+	}
+	return extractAddress(cache, extractTag(cache, blockNumber), blockNumber, 0);
+}
+
+/*
+	Takes in a directory system, the cache with the ID, and the block number
+	of a block the cache is replacing. The block is written back if it is
+	dirty and the cache is removed from its sharers. A cache that is left
+	as the only holder of the block is told it has the only copy, so a
+	SHARED copy becomes EXCLUSIVE and an OWNED copy MODIFIED. The stripe of
+	the block must be locked.
+*/
+static void releaseBlock(cacheSystem_t* cacheSystem, cache_t* cache, uint8_t ID, uint32_t blockNumber) {
+	lockCacheOf(cacheSystem, ID);
+	if (!getValid(cache, blockNumber)) {
+		unlockCacheOf(cacheSystem, ID);
+		return;
+	}
+	uint32_t address = extractAddress(cache, extractTag(cache, blockNumber), blockNumber, 0);
+	evict(cache, blockNumber);
+	invalidateCopy(cache, blockNumber);
+	unlockCacheOf(cacheSystem, ID);
+	snoopy_t* snooper = snooperOf(cacheSystem, address);
+	removeFromSnooper(snooper, address, ID, cacheSystem->blockDataSize);
+	snoopEntry_t* entry = findSnoopEntry(snooper, address, cacheSystem->blockDataSize);
+	if (entry == NULL) {
+		return;
+	}
+
+	// an owner that leaves has just written the block back to memory
+	if (entry->owner == ID && entry->state == OWNED) {
+		entry->state = SHARED;
+	}
+	int sole = returnIDIf1(snooper, address, cacheSystem->blockDataSize);
+	if (sole == -1) {
+		return;
+	}
+	cache_t* other = getCacheFromID(cacheSystem, (uint8_t) sole);
+	lockCacheOf(cacheSystem, (uint8_t) sole);
+	uint32_t otherBlock = probeBlock(other, address).block.blockNumber;
+	if (entry->state == SHARED) {
+		setState(other, otherBlock, EXCLUSIVE);
+		entry->state = EXCLUSIVE;
+	} else {
+		setState(other, otherBlock, MODIFIED);
+		entry->state = MODIFIED;
+	}
+	unlockCacheOf(cacheSystem, (uint8_t) sole);
+	entry->owner = (uint8_t) sole;
+}
+
+/*
+	Takes in a directory system, the ID of the cache that owns a block, the
+	address of the block, and a buffer for the block and copies the block
+	out of the cache. The state of the copy becomes newState.
+*/
+static void fetchFromOwner(cacheSystem_t* cacheSystem, uint8_t ID, uint32_t address, uint8_t* block, enum state newState) {
+	cache_t* cache = getCacheFromID(cacheSystem, ID);
+	lockCacheOf(cacheSystem, ID);
+	uint32_t blockNumber = probeBlock(cache, address).block.blockNumber;
+	fetchBlockInto(cache, blockNumber, block);
+	setState(cache, blockNumber, newState);
+	unlockCacheOf(cacheSystem, ID);
+}
+
+/*
+	Reads size bytes at address from the cache with the ID in a
+	DIRECTORY_COHERENCE system into data. A miss is served by the owner of
+	the block if it has one and from physical memory otherwise, and the
+	block is placed in the cache SHARED, or EXCLUSIVE if no other cache
+	holds it. No other cache is contacted.
+*/
+void directoryReadInto(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint32_t size, uint8_t* data) {
+	cache_t* cache = getCacheFromID(cacheSystem, ID);
+	uint32_t blockAddress = address & ~(cacheSystem->blockDataSize - 1);
+	lockCacheOf(cacheSystem, ID);
+	probeInfo_t info = probeBlock(cache, address);
+	if (!info.block.match) {
+		info.block = chooseVictim(cache, address);
+	}
+	uint32_t blockNumber = info.block.blockNumber;
+	reportAccess(cache);
+	if (info.block.match) {
+		reportHit(cache);
+		cache->policy->onHit(cache, blockNumber);
+		getDataInto(cache, getOffset(cache, address), blockNumber, size, data);
+		unlockCacheOf(cacheSystem, ID);
+		return;
+	}
+
+	// only this cache fills the block, so it is the same once the stripes are held
+	uint32_t replaced = replacedAddress(cache, blockNumber, blockAddress);
+	unlockCacheOf(cacheSystem, ID);
+	lockBlocks(cacheSystem, blockAddress, replaced);
+	releaseBlock(cacheSystem, cache, ID, blockNumber);
+	snoopy_t* snooper = snooperOf(cacheSystem, blockAddress);
+	uint8_t* block = takeBlockBuffer(cache);
+	snoopEntry_t* entry = findSnoopEntry(snooper, blockAddress, cacheSystem->blockDataSize);
+	enum state state = SHARED;
+	enum state home = SHARED;
+	uint8_t owner = 0;
+	if (entry == NULL) {
+		readFromMemInto(cache, blockAddress, block);
+		state = EXCLUSIVE;
+		home = EXCLUSIVE;
+		owner = ID;
+	} else if (entry->state == SHARED) {
+		// memory is up to date when no cache owns the block
+		readFromMemInto(cache, blockAddress, block);
+	} else if (entry->state == MODIFIED || entry->state == OWNED) {
+		fetchFromOwner(cacheSystem, entry->owner, blockAddress, block, OWNED);
+		home = OWNED;
+		owner = entry->owner;
+	} else {
+		fetchFromOwner(cacheSystem, entry->owner, blockAddress, block, SHARED);
+	}
+	lockCacheOf(cacheSystem, ID);
+	fillBlock(cache, blockNumber, blockAddress, block, state);
+	unlockCacheOf(cacheSystem, ID);
+	addToSnooper(snooper, blockAddress, ID, cacheSystem->blockDataSize);
+	entry = findSnoopEntry(snooper, blockAddress, cacheSystem->blockDataSize);
+	entry->state = home;
+	entry->owner = owner;
+	unlockBlocks(cacheSystem, blockAddress, replaced);
+	memcpy(data, block + (address - blockAddress), size);
+	releaseBlockBuffer(cache);
+}
+
+/*
+	Writes size bytes of data at address to the cache with the ID in a
+	DIRECTORY_COHERENCE system. Every other copy of the block is invalidated
+	first, which only contacts the caches the directory lists as sharers,
+	and the block is MODIFIED in the cache afterwards.
+*/
+void directoryWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint32_t size, uint8_t* data) {
+	cache_t* cache = getCacheFromID(cacheSystem, ID);
+	uint32_t blockAddress = address & ~(cacheSystem->blockDataSize - 1);
+	lockCacheOf(cacheSystem, ID);
+	probeInfo_t info = probeBlock(cache, address);
+	if (!info.block.match) {
+		info.block = chooseVictim(cache, address);
+	}
+	uint32_t blockNumber = info.block.blockNumber;
+	reportAccess(cache);
+
+	// no other cache holds a MODIFIED block, so the directory is left alone
+	if (info.state == MODIFIED) {
+		reportHit(cache);
+		cache->policy->onHit(cache, blockNumber);
+		setData(cache, data, blockNumber, size, address - blockAddress);
+		unlockCacheOf(cacheSystem, ID);
+		return;
+	}
+	uint32_t replaced = info.block.match ? blockAddress : replacedAddress(cache, blockNumber, blockAddress);
+	unlockCacheOf(cacheSystem, ID);
+	lockBlocks(cacheSystem, blockAddress, replaced);
+
+	// another write may have invalidated the copy before the stripes were held
+	lockCacheOf(cacheSystem, ID);
+	bool match = info.block.match && holdsBlock(cache, blockNumber, blockAddress);
+	if (match) {
+		reportHit(cache);
+		cache->policy->onHit(cache, blockNumber);
+	}
+	unlockCacheOf(cacheSystem, ID);
+	snoopy_t* snooper = snooperOf(cacheSystem, blockAddress);
+	uint8_t* block = takeBlockBuffer(cache);
+	if (!match) {
+		releaseBlock(cacheSystem, cache, ID, blockNumber);
+		snoopEntry_t* entry = findSnoopEntry(snooper, blockAddress, cacheSystem->blockDataSize);
+		if (entry != NULL && entry->state != SHARED) {
+			// a MODIFIED owner would keep writing its copy until it is invalidated below
+			fetchFromOwner(cacheSystem, entry->owner, blockAddress, block, SHARED);
+		} else if (size < cacheSystem->blockDataSize) {
+			readFromMemInto(cache, blockAddress, block);
+		}
+	}
+
+	// the sharers are the only caches that can hold a copy to invalidate
+	snoopEntry_t* entry = findSnoopEntry(snooper, blockAddress, cacheSystem->blockDataSize);
+	if (entry != NULL) {
+		for (int i = 0; i < SHARER_WORDS; i++) {
+			uint64_t sharers = entry->sharers[i];
+			while (sharers != 0) {
+				uint8_t other = (uint8_t) ((i << 6) + __builtin_ctzll(sharers));
+				sharers &= sharers - 1;
+				if (other != ID) {
+					cache_t* otherCache = getCacheFromID(cacheSystem, other);
+					lockCacheOf(cacheSystem, other);
+					invalidateCopy(otherCache, probeBlock(otherCache, blockAddress).block.blockNumber);
+					unlockCacheOf(cacheSystem, other);
+				}
+			}
+			entry->sharers[i] = 0;
+		}
+		entry->sharers[ID >> 6] = UINT64_C(1) << (ID & 63);
+	} else {
+		addToSnooper(snooper, blockAddress, ID, cacheSystem->blockDataSize);
+		entry = findSnoopEntry(snooper, blockAddress, cacheSystem->blockDataSize);
+	}
+	entry->state = MODIFIED;
+	entry->owner = ID;
+	lockCacheOf(cacheSystem, ID);
+	if (!match) {
+		fillBlock(cache, blockNumber, blockAddress, block, MODIFIED);
+	}
+	setData(cache, data, blockNumber, size, address - blockAddress);
+	setState(cache, blockNumber, MODIFIED);
+	unlockCacheOf(cacheSystem, ID);
+	unlockBlocks(cacheSystem, blockAddress, replaced);
+	releaseBlockBuffer(cache);
+}
@@ -0,0 +1,22 @@
+/* Summer 2017 */
+#ifndef DIRECTORY_H
+#define DIRECTORY_H
+
+/*
+	Reads size bytes at address from the cache with the ID in a
+	DIRECTORY_COHERENCE system into data. A miss is served by the owner of
+	the block if it has one and from physical memory otherwise, and the
+	block is placed in the cache SHARED, or EXCLUSIVE if no other cache
+	holds it. No other cache is contacted.
+*/
+void directoryReadInto(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint32_t size, uint8_t* data);
+
+/*
+	Writes size bytes of data at address to the cache with the ID in a
+	DIRECTORY_COHERENCE system. Every other copy of the block is invalidated
+	first, which only contacts the caches the directory lists as sharers,
+	and the block is MODIFIED in the cache afterwards.
+*/
+void directoryWrite(cacheSystem_t* cacheSystem, uint32_t address, uint8_t ID, uint32_t size, uint8_t* data);
+
+#endif
@@ -0,0 +1,185 @@
+/* Summer 2017 */
+#include <stdint.h>
+#include <pthread.h>
+#include "bitcopy.h"
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#if defined(__GNUC__) && (defined(__x86_64__) || defined(__i386__))
+#include <immintrin.h>
+#define HAVE_AVX2_KERNELS 1
+#endif
+
+/*
+	Scalar versions of the copy kernels. They produce the same results
+	as copyFromBitOffset and copyToBitOffset on any processor.
+*/
+void copyFromBitOffsetScalar(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	for (uint32_t i = 0; i < length; i++) {
+		dst[i] = (uint8_t) ((src[i] << shiftAmount) | (src[i + 1] >> (8 - shiftAmount)));
+	}
+}
+
+void copyToBitOffsetScalar(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	if (length == 0) {
+		return;
+	}
+	uint8_t keepFirst = (uint8_t) (0xFF << (8 - shiftAmount));
+	dst[0] = (dst[0] & keepFirst) | (src[0] >> shiftAmount);
+	for (uint32_t i = 1; i < length; i++) {
+		dst[i] = (uint8_t) ((src[i - 1] << (8 - shiftAmount)) | (src[i] >> shiftAmount));
+	}
+	dst[length] = (dst[length] & ~keepFirst) | (uint8_t) (src[length - 1] << (8 - shiftAmount));
+}
+
+#if defined(__SSE2__)
+/*
+	SSE2 kernels. There is no byte shift so every byte is shifted as part of
+	a 16 bit lane and the bits that crossed into the neighbouring byte are
+	masked off.
+*/
+static void copyFromBitOffsetSSE2(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	uint32_t i = 0;
+	__m128i left = _mm_cvtsi32_si128(shiftAmount);
+	__m128i right = _mm_cvtsi32_si128(8 - shiftAmount);
+	__m128i highMask = _mm_set1_epi8((char) (0xFF << shiftAmount));
+	__m128i lowMask = _mm_set1_epi8((char) (0xFF >> (8 - shiftAmount)));
+	for (; i + 16 <= length; i += 16) {
+		__m128i current = _mm_loadu_si128((__m128i*) (src + i));
+		__m128i next = _mm_loadu_si128((__m128i*) (src + i + 1));
+		__m128i high = _mm_and_si128(_mm_sll_epi16(current, left), highMask);
+		__m128i low = _mm_and_si128(_mm_srl_epi16(next, right), lowMask);
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(high, low));
+	}
+	copyFromBitOffsetScalar(dst + i, src + i, shiftAmount, length - i);
+}
+
+static void copyToBitOffsetSSE2(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	if (length < 17) {
+		copyToBitOffsetScalar(dst, src, shiftAmount, length);
+		return;
+	}
+	uint8_t keepFirst = (uint8_t) (0xFF << (8 - shiftAmount));
+	uint32_t i = 1;
+	__m128i left = _mm_cvtsi32_si128(8 - shiftAmount);
+	__m128i right = _mm_cvtsi32_si128(shiftAmount);
+	__m128i highMask = _mm_set1_epi8((char) (0xFF << (8 - shiftAmount)));
+	__m128i lowMask = _mm_set1_epi8((char) (0xFF >> shiftAmount));
+	dst[0] = (dst[0] & keepFirst) | (src[0] >> shiftAmount);
+	for (; i + 16 <= length; i += 16) {
+		__m128i previous = _mm_loadu_si128((__m128i*) (src + i - 1));
+		__m128i current = _mm_loadu_si128((__m128i*) (src + i));
+		__m128i high = _mm_and_si128(_mm_sll_epi16(previous, left), highMask);
+		__m128i low = _mm_and_si128(_mm_srl_epi16(current, right), lowMask);
+		_mm_storeu_si128((__m128i*) (dst + i), _mm_or_si128(high, low));
+	}
+	for (; i < length; i++) {
+		dst[i] = (uint8_t) ((src[i - 1] << (8 - shiftAmount)) | (src[i] >> shiftAmount));
+	}
+	dst[length] = (dst[length] & ~keepFirst) | (uint8_t) (src[length - 1] << (8 - shiftAmount));
+}
+#endif
+
+#if defined(HAVE_AVX2_KERNELS)
+/*
+	AVX2 kernels. Same approach as the SSE2 kernels on 32 bytes at a time.
+	Only called after the processor has been checked for AVX2 support.
+*/
+__attribute__((target("avx2")))
+static void copyFromBitOffsetAVX2(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	uint32_t i = 0;
+	__m128i left = _mm_cvtsi32_si128(shiftAmount);
+	__m128i right = _mm_cvtsi32_si128(8 - shiftAmount);
+	__m256i highMask = _mm256_set1_epi8((char) (0xFF << shiftAmount));
+	__m256i lowMask = _mm256_set1_epi8((char) (0xFF >> (8 - shiftAmount)));
+	for (; i + 32 <= length; i += 32) {
+		__m256i current = _mm256_loadu_si256((__m256i*) (src + i));
+		__m256i next = _mm256_loadu_si256((__m256i*) (src + i + 1));
+		__m256i high = _mm256_and_si256(_mm256_sll_epi16(current, left), highMask);
+		__m256i low = _mm256_and_si256(_mm256_srl_epi16(next, right), lowMask);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_or_si256(high, low));
+	}
+	copyFromBitOffsetScalar(dst + i, src + i, shiftAmount, length - i);
+}
+
+__attribute__((target("avx2")))
+static void copyToBitOffsetAVX2(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	if (length < 33) {
+		copyToBitOffsetScalar(dst, src, shiftAmount, length);
+		return;
+	}
+	uint8_t keepFirst = (uint8_t) (0xFF << (8 - shiftAmount));
+	uint32_t i = 1;
+	__m128i left = _mm_cvtsi32_si128(8 - shiftAmount);
+	__m128i right = _mm_cvtsi32_si128(shiftAmount);
+	__m256i highMask = _mm256_set1_epi8((char) (0xFF << (8 - shiftAmount)));
+	__m256i lowMask = _mm256_set1_epi8((char) (0xFF >> shiftAmount));
+	dst[0] = (dst[0] & keepFirst) | (src[0] >> shiftAmount);
+	for (; i + 32 <= length; i += 32) {
+		__m256i previous = _mm256_loadu_si256((__m256i*) (src + i - 1));
+		__m256i current = _mm256_loadu_si256((__m256i*) (src + i));
+		__m256i high = _mm256_and_si256(_mm256_sll_epi16(previous, left), highMask);
+		__m256i low = _mm256_and_si256(_mm256_srl_epi16(current, right), lowMask);
+		_mm256_storeu_si256((__m256i*) (dst + i), _mm256_or_si256(high, low));
+	}
+	for (; i < length; i++) {
+		dst[i] = (uint8_t) ((src[i - 1] << (8 - shiftAmount)) | (src[i] >> shiftAmount));
+	}
+	dst[length] = (dst[length] & ~keepFirst) | (uint8_t) (src[length - 1] << (8 - shiftAmount));
+}
+#endif
+
+/*
+	Pointers to the kernels in use. They are set by selectKernels, which
+	runs once on the first copy even when several threads make their first
+	copy at the same time.
+*/
+static void (*copyFromKernel)(uint8_t*, uint8_t*, uint8_t, uint32_t) = NULL;
+static void (*copyToKernel)(uint8_t*, uint8_t*, uint8_t, uint32_t) = NULL;
+static pthread_once_t kernelsSelected = PTHREAD_ONCE_INIT;
+
+/*
+	Picks the widest kernels the processor supports.
+*/
+static void selectKernels() {
+	void (*from)(uint8_t*, uint8_t*, uint8_t, uint32_t) = copyFromBitOffsetScalar;
+	void (*to)(uint8_t*, uint8_t*, uint8_t, uint32_t) = copyToBitOffsetScalar;
+#if defined(__SSE2__)
+	from = copyFromBitOffsetSSE2;
+	to = copyToBitOffsetSSE2;
+#endif
+#if defined(HAVE_AVX2_KERNELS)
+	__builtin_cpu_init();
+	if (__builtin_cpu_supports("avx2")) {
+		from = copyFromBitOffsetAVX2;
+		to = copyToBitOffsetAVX2;
+	}
+#endif
+	copyFromKernel = from;
+	copyToKernel = to;
+}
+
+/*
+	Takes in a destination buffer, a source buffer, a shift amount between
+	1 and 7, and a length in bytes. Copies the length bytes of data that
+	start shiftAmount bits into the first source byte into the destination,
+	so the source must hold length + 1 bytes. Uses the widest SIMD kernel
+	the processor supports.
+*/
+void copyFromBitOffset(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	pthread_once(&kernelsSelected, selectKernels);
+	copyFromKernel(dst, src, shiftAmount, length);
+}
+
+/*
+	Takes in a destination buffer, a source buffer, a shift amount between
+	1 and 7, and a length in bytes. Copies the length bytes of the source so
+	they start shiftAmount bits into the first destination byte, leaving the
+	first shiftAmount bits of the first destination byte and the last
+	8 - shiftAmount bits of destination byte length unchanged. Uses the
+	widest SIMD kernel the processor supports.
+*/
+void copyToBitOffset(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length) {
+	pthread_once(&kernelsSelected, selectKernels);
+	copyToKernel(dst, src, shiftAmount, length);
+}
@@ -0,0 +1,31 @@
+/* Summer 2017 */
+#ifndef BITCOPY_H
+#define BITCOPY_H
+
+/*
+	Takes in a destination buffer, a source buffer, a shift amount between
+	1 and 7, and a length in bytes. Copies the length bytes of data that
+	start shiftAmount bits into the first source byte into the destination,
+	so the source must hold length + 1 bytes. Uses the widest SIMD kernel
+	the processor supports.
+*/
+void copyFromBitOffset(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length);
+
+/*
+	Takes in a destination buffer, a source buffer, a shift amount between
+	1 and 7, and a length in bytes. Copies the length bytes of the source so
+	they start shiftAmount bits into the first destination byte, leaving the
+	first shiftAmount bits of the first destination byte and the last
+	8 - shiftAmount bits of destination byte length unchanged. Uses the
+	widest SIMD kernel the processor supports.
+*/
+void copyToBitOffset(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length);
+
+/*
+	Scalar versions of the copy kernels. They produce the same results
+	as copyFromBitOffset and copyToBitOffset on any processor.
+*/
+void copyFromBitOffsetScalar(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length);
+void copyToBitOffsetScalar(uint8_t* dst, uint8_t* src, uint8_t shiftAmount, uint32_t length);
+
+#endif
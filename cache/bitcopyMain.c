@@ -0,0 +1,58 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdint.h>
+#include "bitcopy.h"
+
+#define MAX_LENGTH 200
+#define GUARD 8
+
+/*
+	Checks that copyFromBitOffset and copyToBitOffset, which use the widest
+	SIMD kernel the processor supports, produce the same bytes as the scalar
+	kernels for every shift amount and every length up to MAX_LENGTH,
+	including 0 and the lengths that leave a tail after the last full
+	vector. The buffers start at every alignment within a vector and are
+	surrounded by guard bytes so a write past either end is caught as well.
+	Returns 1 if any copy differs.
+*/
+int main() {
+	static uint8_t src[MAX_LENGTH + 2 * GUARD + 32];
+	static uint8_t fast[MAX_LENGTH + 2 * GUARD + 32];
+	static uint8_t slow[MAX_LENGTH + 2 * GUARD + 32];
+	uint64_t state = 88172645463325252ULL;
+	long mismatches = 0;
+
+	for (uint32_t i = 0; i < sizeof(src); i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		src[i] = (uint8_t) state;
+	}
+	for (uint32_t align = 0; align < 32; align += 3) {
+		for (uint8_t shiftAmount = 1; shiftAmount < 8; shiftAmount++) {
+			for (uint32_t length = 0; length <= MAX_LENGTH; length++) {
+				uint8_t* in = src + GUARD + align;
+				memset(fast, 0xA5, sizeof(fast));
+				memset(slow, 0xA5, sizeof(slow));
+				copyFromBitOffset(fast + GUARD + align, in, shiftAmount, length);
+				copyFromBitOffsetScalar(slow + GUARD + align, in, shiftAmount, length);
+				if (memcmp(fast, slow, sizeof(fast)) != 0) {
+					printf("copyFromBitOffset differs: shift %u length %u align %u\n", shiftAmount, length, align);
+					mismatches++;
+				}
+				memset(fast, 0x5A, sizeof(fast));
+				memset(slow, 0x5A, sizeof(slow));
+				copyToBitOffset(fast + GUARD + align, in, shiftAmount, length);
+				copyToBitOffsetScalar(slow + GUARD + align, in, shiftAmount, length);
+				if (memcmp(fast, slow, sizeof(fast)) != 0) {
+					printf("copyToBitOffset differs: shift %u length %u align %u\n", shiftAmount, length, align);
+					mismatches++;
+				}
+			}
+		}
+	}
+	printf("%ld copies differ from the scalar kernels\n", mismatches);
+	return mismatches != 0;
+}
@@ -0,0 +1,79 @@
+/* Summer 2017 */
+#include <string.h>
+#include <stdint.h>
+#include "bitfield.h"
+
+/*
+	Takes in a pointer to any byte and returns the 8 bytes starting there
+	as a big endian 64 bit value. The pointer does not need to be aligned.
+*/
+static inline uint64_t loadBigEndian(uint8_t* bytes) {
+	uint64_t word;
+	memcpy(&word, bytes, sizeof(uint64_t));
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	word = __builtin_bswap64(word);
+#endif
+	return word;
+}
+
+/*
+	Takes in a pointer to any byte and a value and stores the value in the
+	8 bytes starting there in big endian order.
+*/
+static inline void storeBigEndian(uint8_t* bytes, uint64_t word) {
+#if __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+	word = __builtin_bswap64(word);
+#endif
+	memcpy(bytes, &word, sizeof(uint64_t));
+}
+
+/*
+	Takes in a buffer, a location in bits, and a length in bits of at most 64
+	and returns the field of that length starting at that location as the
+	rightmost bits with leading 0s. Bits are numbered from the most
+	significant bit of the first byte, the same order used by getBit.
+*/
+uint64_t readBits(uint8_t* buffer, uint64_t location, uint8_t length) {
+	if (length == 0) {
+		return 0;
+	}
+	uint8_t* bytes = buffer + (location >> 3);
+	uint8_t shiftAmount = location & 7;
+	uint64_t word = loadBigEndian(bytes) << shiftAmount;
+
+	// the field spills into a ninth byte
+	if (shiftAmount + length > 64) {
+		word |= (uint64_t) bytes[8] >> (8 - shiftAmount);
+	}
+	return word >> (64 - length);
+}
+
+/*
+	Takes in a buffer, a location in bits, a length in bits of at most 64,
+	and a value and stores the rightmost length bits of the value into the
+	field of that length starting at that location. All other bits in the
+	buffer are left unchanged.
+*/
+void writeBits(uint8_t* buffer, uint64_t location, uint8_t length, uint64_t value) {
+	if (length == 0) {
+		return;
+	}
+	uint8_t* bytes = buffer + (location >> 3);
+	uint8_t shiftAmount = location & 7;
+	uint64_t fieldMask = UINT64_MAX >> (64 - length);
+	value &= fieldMask;
+	if (shiftAmount + length <= 64) {
+		uint8_t lowBits = 64 - shiftAmount - length;
+		uint64_t word = loadBigEndian(bytes);
+		word = (word & ~(fieldMask << lowBits)) | (value << lowBits);
+		storeBigEndian(bytes, word);
+	} else {
+		// the top 64 - shiftAmount bits go in the first 8 bytes, the rest in the ninth
+		uint8_t spillBits = shiftAmount + length - 64;
+		uint64_t word = loadBigEndian(bytes);
+		word = (word & ~(UINT64_MAX >> shiftAmount)) | (value >> spillBits);
+		storeBigEndian(bytes, word);
+		uint8_t spillMask = (uint8_t) (0xFF << (8 - spillBits));
+		bytes[8] = (bytes[8] & ~spillMask) | (uint8_t) (value << (8 - spillBits));
+	}
+}
@@ -0,0 +1,28 @@
+/* Summer 2017 */
+#ifndef BITFIELD_H
+#define BITFIELD_H
+
+/*
+	Number of bytes that must be readable and writable past the end of any
+	buffer passed to readBits or writeBits. Fields are accessed with whole
+	64 bit loads and stores which may reach past the last byte of a field.
+*/
+#define BITFIELD_PADDING 8
+
+/*
+	Takes in a buffer, a location in bits, and a length in bits of at most 64
+	and returns the field of that length starting at that location as the
+	rightmost bits with leading 0s. Bits are numbered from the most
+	significant bit of the first byte, the same order used by getBit.
+*/
+uint64_t readBits(uint8_t* buffer, uint64_t location, uint8_t length);
+
+/*
+	Takes in a buffer, a location in bits, a length in bits of at most 64,
+	and a value and stores the rightmost length bits of the value into the
+	field of that length starting at that location. All other bits in the
+	buffer are left unchanged.
+*/
+void writeBits(uint8_t* buffer, uint64_t location, uint8_t length, uint64_t value);
+
+#endif
@@ -1,4 +1,6 @@
 /* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "utils.h"
@@ -7,6 +9,11 @@
 #include "cacheWrite.h"
 #include "getFromCache.h"
 #include "mem.h"
+#include "bitcopy.h"
+#include "replacement.h"
+#include "victimCache.h"
+#include "prefetch.h"
+#include "sector.h"
 #include "../hitrate/hitRate.h"
 
 /*
@@ -14,32 +21,59 @@
 	returning it in a uint8_t* pointer.
 */
 uint8_t* fetchBlock(cache_t* cache, uint32_t blockNumber) {
-	uint64_t location = getDataLocation(cache, blockNumber, 0);
-	uint32_t length = cache->blockDataSize;
-	uint8_t* data = malloc(sizeof(uint8_t) << log_2(length));
+	uint8_t* data = malloc(sizeof(uint8_t) * cache->blockDataSize);
 	if (data == NULL) {
 		allocationFailed();
 	}
+	fetchBlockInto(cache, blockNumber, data);
+	return data;
+}
+
+/*
+	Works the same as fetchBlock but copies the block into the buffer passed
+	in, which must hold at least blockDataSize bytes, instead of allocating
+	a new one.
+*/
+void fetchBlockInto(cache_t* cache, uint32_t blockNumber, uint8_t* data) {
+	uint32_t length = cache->blockDataSize;
+	if (cache->layout == ALIGNED) {
+		memcpy(data, cache->data + ((uint64_t) blockNumber * length), length);
+		return;
+	}
+	uint64_t location = getDataLocation(cache, blockNumber, 0);
 	int shiftAmount = location & 7;
 	uint64_t byteLoc = location >> 3;
 	if (shiftAmount == 0) {
-		for (uint32_t i = 0; i < length; i++) {
-			data[i] = cache->contents[byteLoc + i];
-		}
+		memcpy(data, cache->contents + byteLoc, length);
 	} else {
-		length = length << 3;
-		data[0] = cache->contents[byteLoc] << shiftAmount;
-		length -= (8 - shiftAmount);
-		int displacement = 1;
-		while (length > 7) {
-			data[displacement - 1] = data[displacement - 1] | (cache->contents[byteLoc + displacement] >> (8 - shiftAmount));
-			data[displacement] = cache->contents[byteLoc + displacement] << shiftAmount;
-			displacement++;
-			length -= 8;
-		}
-		data[displacement - 1] = data[displacement - 1] | (cache->contents[byteLoc + displacement] >> (8 - shiftAmount));
+		copyFromBitOffset(data, cache->contents + byteLoc, shiftAmount, length);
 	}
-	return data;
+}
+
+/*
+	Takes in a cache, the block number chosen to be evicted on a miss, and
+	the address of the block that missed. Evicts the old block and reads the
+	block that missed into data. If the cache has a victim cache the evicted
+	block is moved into it and the block that missed is taken from it when
+	it is there, otherwise it is read from main memory. Returns 1 if the
+	block that was read is dirty and 0 otherwise.
+*/
+uint8_t fetchMissedBlock(cache_t* cache, uint32_t blockNumber, uint32_t address, uint8_t* data) {
+	if (cache->victim == NULL) {
+		evict(cache, blockNumber);
+		readFromMemInto(cache, address, data);
+		return 0;
+	}
+	int dirty = takeFromVictimCache(cache, address, data);
+	if (dirty >= 0 && getValid(cache, blockNumber)) {
+		reportVictimSwap(cache);
+	}
+	evictToVictimCache(cache, blockNumber);
+	if (dirty < 0) {
+		readFromMemInto(cache, address, data);
+		return 0;
+	}
+	return (uint8_t) dirty;
 }
 
 /*
@@ -53,121 +87,55 @@ uint8_t* readFromCache(cache_t* cache, uint32_t address, uint32_t dataSize) {
 	if (validAddresses(address, dataSize) == 0) {
 		return NULL;
 	}
+	uint8_t* data = (uint8_t*) malloc(sizeof(uint8_t) * dataSize);
+	if (data == NULL) {
+		allocationFailed();
+	}
+	readFromCacheInto(cache, address, dataSize, data);
+	return data;
+}
 
-	// split into 2 adjacent blocks 0, 1
-	// block 0 -> address
-	// block 1 -> address + 1
-
-	uint32_t blockNumber = (cache->totalDataSize) / (cache->blockDataSize);
-    uint32_t addrIndex = getIndex(cache, address);
-    uint32_t addrTag = getTag(cache, address);
-    uint32_t addrOffset = getOffset(cache, address);
-    bool blockFound = false;
-
-    uint8_t* data;
-    for (uint32_t i = 0; i < blockNumber; i++) {
-    	if (getValid(cache, i) == 0) {
-    		continue;
-    	}
-        if (addrIndex == extractIndex(cache, i)) {
-            //if data is in the cache already
-            if (addrTag == extractTag(cache, i)) {
-				reportHit(cache);
-				/*
-				if (cache->blockDataSize < dataSize) {
-					uint32_t numDataBlocks = (dataSize / cache->blockDataSize);
-					uint32_t remainingBytes = (dataSize % cache->blockDataSize);
-					data = (uint8_t*) malloc(sizeof(uint8_t) * dataSize);
-
-					for (int i = 0; i < numDataBlocks; i++) {
-						addrOffset = getOffset(cache, address);
-						uint8_t* temp = getData(cache, addrOffset, i, cache->blockDataSize);
-						for (int k = 0; k < cache->blockDataSize; k++) {
-							data[i*cache->blockDataSize + k] = temp[k];
-						}
-						address += cache->blockDataSize;
-						free(temp);
-					}
-					addrOffset = getOffset(cache, address);
-					temp = getData(cache, addrOffset, i, remainingBytes);
-
-					for (int i = 0; i < remainingBytes; i++) {
-						data[numDataBlocks*cache->blockDataSize + i] = temp[i];
-					}
-					free(temp);
-
-				} else {
-	               	data = getData(cache, addrOffset, i, dataSize);
-					updateLRU(cache, addrTag, addrIndex, getLRU(cache, i));
-				}
-				*/
-				data = getData(cache, addrOffset, i, dataSize);
-				updateLRU(cache, addrTag, addrIndex, getLRU(cache, i));
-				blockFound = true;
-                break;
-            }
-        }
-    }
-
-    // Need to update LRU... where?
-    if (!blockFound) {
-		/*
-    	if (cache->blockDataSize < dataSize) {
-    		uint32_t numDataBlocks = (dataSize / cache->blockDataSize);
-			uint32_t remainingBytes = (dataSize % cache->blockDataSize);
-
-			if (remainingBytes != 0) {
-				numDataBlocks += 1;
-			}
-
-			data = (uint8_t*) malloc(sizeof(uint8_t) * dataSize);
-			uint8_t* temp;
-
-			for (int i = 0; i < numDataBlocks; i++) {
-				evictionInfo_t* toBeEvicted = findEviction(cache, address);
-				uint32_t evictBlockNum = toBeEvicted->blockNumber;
-				evict(cache, toBeEvicted->blockNumber);
-				uint32_t addr = extractAddress(cache, getTag(cache, address), evictBlockNum, 0);
-				temp = readFromMem(cache, addr);
-				writeDataToCache(cache, addr, temp, cache->blockDataSize, getTag(cache, address), toBeEvicted);
-				free(temp);
-				setDirty(cache, evictBlockNum, 0);
-				setTag(cache, addrTag, evictBlockNum);
-				setLRU(cache, evictBlockNum, 0);
-			 	temp = getData(cache, addrOffset, evictBlockNum, cache->blockDataSize);
-			 	for (int k = 0; k < cache->blockDataSize; k++) {
-			 		data[i*cache->blockDataSize + k] = temp[k];
-			 	}
-			 	free(temp);
-			 	free(toBeEvicted);
-			 	address += cache->blockDataSize;
-			}
-
-			if (remainingBytes > 0) {
-				temp = getData(cache, addrOffset, evictBlockNum, cache->blockDataSize);
-				for (int i = 0; i < remainingBytes; i++) {
-					data[(numDataBlocks - 1)*cache->blockDataSize + i] = temp[i];
-				}
-				free(temp);
-			}
-    	} else {
-		*/
-	    	evictionInfo_t* toBeEvicted = findEviction(cache, address);
-	    	uint32_t evictBlockNum = toBeEvicted->blockNumber;
-			evict(cache, toBeEvicted->blockNumber);
-			uint32_t addr = extractAddress(cache, getTag(cache, address), evictBlockNum, 0);
-			data = readFromMem(cache, addr);
-			writeDataToCache(cache, addr, data, cache->blockDataSize, getTag(cache, address), toBeEvicted);
-			free(data);
-			setDirty(cache, evictBlockNum, 0);
-			setTag(cache, addrTag, evictBlockNum);
-			setLRU(cache, evictBlockNum, 0);
-		 	data = getData(cache, addrOffset, evictBlockNum, dataSize);
-			free(toBeEvicted);
+/*
+	Works the same as readFromCache but copies the data that was read into
+	the buffer passed in, which must hold at least dataSize bytes, instead
+	of allocating a new one. Returns -1 if the address is invalid and
+	otherwise 0.
+*/
+int readFromCacheInto(cache_t* cache, uint32_t address, uint32_t dataSize, uint8_t* data) {
+	if (validAddresses(address, dataSize) == 0) {
+		return -1;
+	}
 
-   }
-	return data;
+	uint32_t addrTag = getTag(cache, address);
+	uint32_t addrOffset = getOffset(cache, address);
 
+	// only the n ways of the addressed set can hold the block
+	evictionInfo_t info = findEvictionInfo(cache, address);
+	uint32_t blockNum = info.blockNumber;
+	if (info.match) {
+		if (fillSectors(cache, blockNum, address, dataSize, false)) {
+			reportHit(cache);
+		}
+		getDataInto(cache, addrOffset, blockNum, dataSize, data);
+		cache->policy->onHit(cache, blockNum);
+	} else if (cache->sectorSize != 0) {
+		// only the sectors that are read are fetched
+		allocateSectoredBlock(cache, blockNum, address);
+		fillSectors(cache, blockNum, address, dataSize, false);
+		cache->policy->onFill(cache, blockNum);
+		getDataInto(cache, addrOffset, blockNum, dataSize, data);
+	} else {
+		uint8_t* block = takeBlockBuffer(cache);
+		uint32_t addr = extractAddress(cache, addrTag, blockNum, 0);
+		uint8_t dirty = fetchMissedBlock(cache, blockNum, addr, block);
+		writeDataToCache(cache, addr, block, cache->blockDataSize, &info);
+		releaseBlockBuffer(cache);
+		setDirty(cache, blockNum, dirty);
+		setTag(cache, addrTag, blockNum);
+		getDataInto(cache, addrOffset, blockNum, dataSize, data);
+	}
+	runPrefetcher(cache, address, blockNum, info.match);
+	return 0;
 }
 
 /*
@@ -183,10 +151,10 @@ byteInfo_t readByte(cache_t* cache, uint32_t address) {
 	if (validAddresses(address, 1) == 0) {
 		retVal.success = false;
 	} else {
-		uint8_t* _data = readFromCache(cache, address, 1);
-		retVal.data = *(_data);
+		uint8_t _data[1];
+		readFromCacheInto(cache, address, 1, _data);
+		retVal.data = _data[0];
 		retVal.success = true;
-		free(_data);
 		reportAccess(cache);
 	}
 	return retVal;
@@ -214,12 +182,12 @@ halfWordInfo_t readHalfWord(cache_t* cache, uint32_t address) {
 				address++;
 			}
 		} else {
-			uint8_t* _data = readFromCache(cache, address, 2);
+			uint8_t _data[2];
+			readFromCacheInto(cache, address, 2, _data);
 			reportAccess(cache);
 			for (int i = 0; i < 2; i++) {
 				retVal.data += ((uint16_t) _data[i] << (8 * (1 - i)));
 			}
-			free(_data);
 		}
 		retVal.success = true;
 	}
@@ -247,12 +215,12 @@ wordInfo_t readWord(cache_t* cache, uint32_t address) {
 				address += 2;
 			}
 		} else {
-			uint8_t* _data = readFromCache(cache, address, 4);
+			uint8_t _data[4];
+			readFromCacheInto(cache, address, 4, _data);
 			reportAccess(cache);
 			for (int i = 0; i < 4; i++) {
 				retVal.data += ((uint32_t) _data[i] << (8 * (3- i)));
 			}
-			free(_data);
 		}
 		retVal.success = true;
 	}
@@ -280,12 +248,12 @@ doubleWordInfo_t readDoubleWord(cache_t* cache, uint32_t address) {
 				address += 4;
 			}
 		} else {
-			uint8_t* _data = readFromCache(cache, address, 8);
+			uint8_t _data[8];
+			readFromCacheInto(cache, address, 8, _data);
 			reportAccess(cache);
 			for (int i = 0; i < 8; i++) {
 				retVal.data += (uint64_t) ((uint64_t) _data[i] << (uint64_t) (8 * (7 - i)));
 			}
-			free(_data);
 		}
 		retVal.success = true;
 	}
@@ -8,6 +8,23 @@
 */
 uint8_t* fetchBlock(cache_t* cache, uint32_t blockNumber);
 
+/*
+	Works the same as fetchBlock but copies the block into the buffer passed
+	in, which must hold at least blockDataSize bytes, instead of allocating
+	a new one.
+*/
+void fetchBlockInto(cache_t* cache, uint32_t blockNumber, uint8_t* data);
+
+/*
+	Takes in a cache, the block number chosen to be evicted on a miss, and
+	the address of the block that missed. Evicts the old block and reads the
+	block that missed into data. If the cache has a victim cache the evicted
+	block is moved into it and the block that missed is taken from it when
+	it is there, otherwise it is read from main memory. Returns 1 if the
+	block that was read is dirty and 0 otherwise.
+*/
+uint8_t fetchMissedBlock(cache_t* cache, uint32_t blockNumber, uint32_t address, uint8_t* data);
+
 /*
 	Takes in a cache, an address, and a dataSize and reads from the cache at
 	that address the number of bytes indicated by the size. If the data block 
@@ -17,6 +34,14 @@ uint8_t* fetchBlock(cache_t* cache, uint32_t blockNumber);
 */
 uint8_t* readFromCache(cache_t* cache, uint32_t address, uint32_t dataSize);
 
+/*
+	Works the same as readFromCache but copies the data that was read into
+	the buffer passed in, which must hold at least dataSize bytes, instead
+	of allocating a new one. Returns -1 if the address is invalid and
+	otherwise 0.
+*/
+int readFromCacheInto(cache_t* cache, uint32_t address, uint32_t dataSize, uint8_t* data);
+
 /*
 	Takes in a cache and an address and fetches a byte of data.
 	Returns a struct containing a bool field of whether or not
@@ -1,4 +1,5 @@
 /* Summer 2017 */
+#include <stdlib.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "utils.h"
@@ -6,79 +7,194 @@
 #include "getFromCache.h"
 #include "mem.h"
 #include "setInCache.h"
+#include "cacheRead.h"
+#include "replacement.h"
+#include "victimCache.h"
+#include "prefetch.h"
+#include "sector.h"
+#include "hierarchy.h"
 #include "../hitrate/hitRate.h"
 
+/*
+	Struct used to hold a dirty block and the address it is written back to
+	while the blocks of a cache are sorted by address.
+*/
+typedef struct dirtyBlock
+{
+	uint32_t address;
+	uint32_t blockNumber;
+} dirtyBlock_t;
+
+/*
+	Compares two dirty blocks by address for qsort. Blocks with the same
+	address stay in block number order so the last one is written last as
+	it would be by evicting every block in order.
+*/
+static int compareDirtyBlocks(const void* first, const void* second) {
+	const dirtyBlock_t* a = first;
+	const dirtyBlock_t* b = second;
+	if (a->address != b->address) {
+		return a->address < b->address ? -1 : 1;
+	}
+	return a->blockNumber < b->blockNumber ? -1 : (a->blockNumber > b->blockNumber);
+}
+
 /*
 	Takes in a cache and a block number and evicts the block at that number
 	from the cache. This does not change any of the bits in the cache but
 	checks if data needs to be written to main memory or and then makes
-	calls to the appropriate functions to do so.
+	calls to the appropriate functions to do so. An inclusive cache first
+	invalidates the copies of the block in its upper levels and a block
+	whose next level is exclusive is placed in that level instead.
 */
 void evict(cache_t* cache, uint32_t blockNumber) {
 	uint8_t valid = getValid(cache, blockNumber);
+	if (valid) {
+		backInvalidate(cache, blockNumber);
+		if (evictToLowerLevel(cache, blockNumber)) {
+			return;
+		}
+	}
 	uint8_t dirty = getDirty(cache, blockNumber);
 	if (valid && dirty) {
 		uint32_t tag = extractTag(cache, blockNumber);
 		uint32_t address = extractAddress(cache, tag, blockNumber, 0);
-		writeToMem(cache, blockNumber, address);
+		if (cache->sectorSize != 0) {
+			writeBackSectors(cache, blockNumber, address);
+		} else {
+			writeToMem(cache, blockNumber, address);
+		}
 	}
 }
 
+/*
+	Takes in a cache and writes every valid dirty block back to main memory.
+	The blocks are sorted by address and blocks that are next to each other
+	in memory are written as one run, so memory is written in a single
+	sequential pass. The dirty blocks of its victim cache are written back
+	after them. Like evict this does not change any of the bits in the
+	cache.
+*/
+void writeBackAll(cache_t* cache) {
+	uint32_t numBlocks = cache->geometry.numBlocks;
+	uint32_t blockDataSize = cache->blockDataSize;
+	uint32_t count = 0;
+	dirtyBlock_t* dirty = malloc(sizeof(dirtyBlock_t) * numBlocks);
+	if (dirty == NULL) {
+		allocationFailed();
+	}
+	for (uint32_t i = 0; i < numBlocks; i++) {
+		if (getValid(cache, i) && getDirty(cache, i)) {
+			dirty[count].address = extractAddress(cache, extractTag(cache, i), i, 0);
+			dirty[count].blockNumber = i;
+			count++;
+		}
+	}
+	if (count == 0) {
+		free(dirty);
+		writeBackVictimCache(cache);
+		return;
+	}
+	qsort(dirty, count, sizeof(dirtyBlock_t), compareDirtyBlocks);
+	if (cache->sectorSize != 0) {
+		// only the dirty sectors of each block are written
+		for (uint32_t i = 0; i < count; i++) {
+			writeBackSectors(cache, dirty[i].blockNumber, dirty[i].address);
+		}
+		free(dirty);
+		writeBackVictimCache(cache);
+		return;
+	}
+	uint8_t* run = malloc(sizeof(uint8_t) * blockDataSize * count);
+	if (run == NULL) {
+		free(dirty);
+		allocationFailed();
+	}
+	uint32_t start = 0;
+	for (uint32_t i = 0; i < count; i++) {
+		fetchBlockInto(cache, dirty[i].blockNumber, run + (uint64_t) (i - start) * blockDataSize);
+		// a run ends at the last block or where the next block is not adjacent
+		if (i + 1 == count || dirty[i + 1].address != dirty[i].address + blockDataSize) {
+			writeBytesToMem(cache, dirty[start].address, run, (i + 1 - start) * blockDataSize);
+			start = i + 1;
+		}
+	}
+	free(run);
+	free(dirty);
+	writeBackVictimCache(cache);
+}
+
 /*
 	Takes in a cache, an address, a pointer to data, and a size of data
 	and writes the updated data to the cache. If the data block is already
 	in the cache it updates the contents and sets the dirty bit. If the
 	contents are not in the cache it is written to a new slot and
-	if necessary something is evicted from the cache.
+	if necessary something is evicted from the cache. A WRITE_THROUGH cache
+	also writes the data to physical memory and leaves the block clean. A
+	cache without write allocate writes a store that misses straight to
+	physical memory, or into its victim cache if that holds the block.
 */
 void writeToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize) {
-    uint32_t blockNumber = (cache->totalDataSize) / (cache->blockDataSize);
-    uint32_t addrIndex = getIndex(cache, address);
-    uint32_t addrTag = getTag(cache, address);
-    bool blockFound = false;
+	uint32_t addrTag = getTag(cache, address);
 
-    for (uint32_t i = 0; i < blockNumber; i++) {
-        if (addrIndex == extractIndex(cache, i)) {
-            if (addrTag == extractTag(cache, i)) {
-				reportHit(cache);
-                evictionInfo_t* toBeEvicted = findEviction(cache, address);
-				writeDataToCache(cache, address, data, dataSize, addrTag, toBeEvicted);
-				blockFound = true;
-				free(toBeEvicted);
-	            break;
-            }
-        }
-    }
-
-    if (!blockFound) {
-        evictionInfo_t* toBeEvicted = findEviction(cache, address);
-        uint32_t evictBlockNum = toBeEvicted->blockNumber;
-        evict(cache, toBeEvicted->blockNumber);
+	// only the n ways of the addressed set can hold the block
+	evictionInfo_t toBeEvicted = lookupBlock(cache, address);
+	if (!toBeEvicted.match && cache->writeAllocate) {
+		toBeEvicted = chooseVictim(cache, address);
+	}
+	uint32_t evictBlockNum = toBeEvicted.blockNumber;
+	if (toBeEvicted.match) {
+		if (fillSectors(cache, evictBlockNum, address, dataSize, true)) {
+			reportHit(cache);
+		}
+		writeDataToCache(cache, address, data, dataSize, &toBeEvicted);
+	} else if (!cache->writeAllocate) {
+		// the store goes around the cache unless the victim cache holds the block
+		int held = writeToVictimCache(cache, address, data, dataSize, cache->writePolicy == WRITE_BACK);
+		if (!held || cache->writePolicy == WRITE_THROUGH) {
+			writeBytesToMem(cache, address, data, dataSize);
+		}
+		return;
+	} else if (cache->sectorSize != 0) {
+		// only the sectors the store leaves partly unwritten are fetched
+		allocateSectoredBlock(cache, evictBlockNum, address);
+		fillSectors(cache, evictBlockNum, address, dataSize, true);
+		writeDataToCache(cache, address, data, dataSize, &toBeEvicted);
+	} else {
+		uint8_t* toWrite = takeBlockBuffer(cache);
+		uint32_t addr = extractAddress(cache, addrTag, evictBlockNum, 0);
+		fetchMissedBlock(cache, evictBlockNum, addr, toWrite);
 		setDirty(cache, evictBlockNum, 0);
-		uint32_t addr = extractAddress(cache, getTag(cache, address), evictBlockNum, 0);
-		uint8_t* toWrite = readFromMem(cache, addr);
-		writeDataToCache(cache, addr, toWrite, cache->blockDataSize, getTag(cache, address), toBeEvicted);
+		writeDataToCache(cache, addr, toWrite, cache->blockDataSize, &toBeEvicted);
+		releaseBlockBuffer(cache);
 		setData(cache, data, evictBlockNum, dataSize, getOffset(cache, address));
 		setTag(cache, addrTag, evictBlockNum);
-		setLRU(cache, evictBlockNum, 0);
-		free(toBeEvicted);
-		free(toWrite);
-    }
+	}
+	markSectors(cache, evictBlockNum, getOffset(cache, address), dataSize, cache->writePolicy == WRITE_BACK);
+	if (cache->writePolicy == WRITE_THROUGH) {
+		setDirty(cache, evictBlockNum, 0);
+		writeBytesToMem(cache, address, data, dataSize);
+	}
+	runPrefetcher(cache, address, evictBlockNum, toBeEvicted.match);
 }
 
 /*
 	Takes in a cache, an address to write to, a pointer containing the data
-	to write, the size of the data, a tag, and a pointer to an evictionInfo
-	struct and writes the data given to the cache based upon the location
-	given by the evictionInfo struct.
+	to write, the size of the data, and a pointer to an evictionInfo struct
+	and writes the data given to the cache based upon the location given by
+	the evictionInfo struct. The tag of the block is left alone, so a block
+	that is filled gets its tag set by the caller.
 */
-void writeDataToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize, uint32_t tag, evictionInfo_t* evictionInfo) {
-	uint32_t idx = getIndex(cache, address);
+void writeDataToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize, evictionInfo_t* evictionInfo) {
 	setData(cache, data, evictionInfo->blockNumber, dataSize , getOffset(cache, address));
 	setDirty(cache, evictionInfo->blockNumber, 1);
 	setValid(cache, evictionInfo->blockNumber, 1);
 	setShared(cache, evictionInfo->blockNumber, 0);
-	updateLRU(cache, tag, idx, evictionInfo->LRU);
+	if (evictionInfo->match) {
+		cache->policy->onHit(cache, evictionInfo->blockNumber);
+	} else {
+		cache->policy->onFill(cache, evictionInfo->blockNumber);
+	}
 }
 
 /*
@@ -192,13 +308,11 @@ int writeDoubleWord(cache_t* cache, uint32_t address, uint64_t data) {
 	to and an entire block of data from another cache.
 */
 void writeWholeBlock(cache_t* cache, uint32_t address, uint32_t evictionBlockNumber, uint8_t* data) {
-	uint32_t idx = getIndex(cache, address);
 	uint32_t tagVal = getTag(cache, address);
-	int oldLRU = getLRU(cache, evictionBlockNumber);
 	evict(cache, evictionBlockNumber);
 	setValid(cache, evictionBlockNumber, 1);
 	setDirty(cache, evictionBlockNumber, 0);
 	setTag(cache, tagVal, evictionBlockNumber);
 	setData(cache, data, evictionBlockNumber, cache->blockDataSize, 0);
-	updateLRU(cache, tagVal, idx, oldLRU);
+	cache->policy->onFill(cache, evictionBlockNumber);
 }
@@ -6,26 +6,42 @@
 	Takes in a cache and a block number and evicts the block at that number
 	from the cache. This does not change any of the bits in the cache but 
 	checks if data needs to be written to main memory or and then makes 
-	calls to the appropriate functions to do so.
+	calls to the appropriate functions to do so. An inclusive cache first
+	invalidates the copies of the block in its upper levels and a block
+	whose next level is exclusive is placed in that level instead.
 */
 void evict(cache_t* cache, uint32_t blockNumber);
 
+/*
+	Takes in a cache and writes every valid dirty block back to main memory.
+	The blocks are sorted by address and blocks that are next to each other
+	in memory are written as one run, so memory is written in a single
+	sequential pass. The dirty blocks of its victim cache are written back
+	after them. Like evict this does not change any of the bits in the
+	cache.
+*/
+void writeBackAll(cache_t* cache);
+
 /*
 	Takes in a cache, an address, a pointer to data, and a size of data
 	and writes the updated data to the cache. If the data block is already
 	in the cache it updates the contents and sets the dirty bit. If the
-	contents are not in the cache it is written to a new slot and 
-	if necessary something is evicted from the cache.
+	contents are not in the cache it is written to a new slot and
+	if necessary something is evicted from the cache. A WRITE_THROUGH cache
+	also writes the data to physical memory and leaves the block clean. A
+	cache without write allocate writes a store that misses straight to
+	physical memory, or into its victim cache if that holds the block.
 */
 void writeToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize);
 
 /*
 	Takes in a cache, an address to write to, a pointer containing the data
-	to write, the size of the data, a tag, and a pointer to an evictionInfo
-	struct and writes the data given to the cache based upon the location
-	given by the evictionInfo struct.
+	to write, the size of the data, and a pointer to an evictionInfo struct
+	and writes the data given to the cache based upon the location given by
+	the evictionInfo struct. The tag of the block is left alone, so a block
+	that is filled gets its tag set by the caller.
 */
-void writeDataToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize, uint32_t tag, evictionInfo_t* evictionInfo);
+void writeDataToCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t dataSize, evictionInfo_t* evictionInfo);
 
 /*
 	Takes in a cache, an address, and a byte of data and writes the byte
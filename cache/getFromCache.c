@@ -1,11 +1,15 @@
 /* Summer 2017 */
 #include <stdlib.h>
+#include <string.h>
 #include <math.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include <omp.h>
 #include "utils.h"
 #include "getFromCache.h"
+#include "bitfield.h"
+#include "bitcopy.h"
+#include "replacement.h"
 
 /*
 	Takes in a cache and a blocknumber and returns that block's valid bit.
@@ -15,6 +19,9 @@ uint8_t getValid(cache_t* cache, uint32_t blockNumber) {
 	if (cache == NULL) {
 		return 0;
 	}
+	if (cache->layout == ALIGNED) {
+		return (cache->flags[blockNumber] & VALID_FLAG) != 0;
+	}
 	uint64_t validLocation = getValidLocation(cache, blockNumber);
 	return getBit(cache, validLocation);
 }
@@ -27,6 +34,9 @@ uint8_t getDirty(cache_t* cache, uint32_t blockNumber) {
 	if (cache == NULL) {
 		return 0;
 	}
+	if (cache->layout == ALIGNED) {
+		return (cache->flags[blockNumber] & DIRTY_FLAG) != 0;
+	}
 	uint64_t dirtyLocation = getDirtyLocation(cache, blockNumber);
 	return getBit(cache, dirtyLocation);
 }
@@ -39,6 +49,9 @@ uint8_t getShared(cache_t* cache, uint32_t blockNumber) {
 	if (cache == NULL) {
 		return 0;
 	}
+	if (cache->layout == ALIGNED) {
+		return (cache->flags[blockNumber] & SHARED_FLAG) != 0;
+	}
 	uint64_t sharedLocation = getSharedLocation(cache, blockNumber);
 	return getBit(cache, sharedLocation);
 }
@@ -52,10 +65,10 @@ uint8_t getBit(cache_t* cache, uint64_t location) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint8_t bitNumber = location % 8;
-	uint8_t contentBits = cache->contents[location / 8];
-	return (uint8_t) ((contentBits >> (7 - bitNumber)) & 1);
-
+	if (cache->layout == ALIGNED) {
+		return getAlignedBit(cache, location);
+	}
+	return (uint8_t) readBits(cache->contents, location, 1);
 }
 
 /*
@@ -64,13 +77,10 @@ uint8_t getBit(cache_t* cache, uint64_t location) {
 */
 long getLRU(cache_t* cache, uint32_t blockNumber) {
 	/* Your Code Here. */
-	uint64_t lruLocation = getLRULocation(cache, blockNumber);
-	uint8_t numBits = numLRUBits(cache);
-	long lruBits = 0;
-	for (uint8_t i = 0; i < numBits; i++) {
-		lruBits += ((((uint64_t) getBit(cache, lruLocation + i)) << (numBits - 1 - i)));
+	if (cache->layout == ALIGNED) {
+		return (long) cache->LRU[blockNumber];
 	}
-	return ((long) lruBits);
+	return (long) readBits(cache->contents, getLRULocation(cache, blockNumber), cache->geometry.lruBits);
 }
 
 /*
@@ -78,22 +88,10 @@ long getLRU(cache_t* cache, uint32_t blockNumber) {
 	for the block specified.
 */
 uint32_t extractTag(cache_t* cache, uint32_t blockNumber) {
-	uint64_t location = getTagLocation(cache, blockNumber);
-	uint64_t byteLoc = location >> 3;
-	int shiftAmount = location & 7;
-	if (shiftAmount != 0) {
-		uint64_t newTag = (((uint64_t)  cache->contents[byteLoc]) << 56) + (((uint64_t) cache->contents[byteLoc + 1]) << 48)
-	 	+ (((uint64_t)  cache->contents[byteLoc + 2]) << 40) + (((uint64_t) cache->contents[byteLoc + 3]) << 32)
-	 	+ (((uint64_t) cache->contents[byteLoc + 4]) << 24);
-	 	newTag = (newTag  << (shiftAmount));
-	 	newTag = newTag >> (64 - getTagSize(cache));
-		return ((uint32_t) newTag);
-	} else {
-		uint32_t newTag = (((uint32_t)  cache->contents[byteLoc]) << 24) + ((uint32_t) cache->contents[byteLoc + 1] << 16)
-	 	+ (((uint32_t)  cache->contents[byteLoc + 2]) << 8) + ((uint32_t) cache->contents[byteLoc + 3]);
-	 	newTag = newTag >> (32 - getTagSize(cache));
-	 	return newTag;
+	if (cache->layout == ALIGNED) {
+		return cache->tags[blockNumber];
 	}
+	return (uint32_t) readBits(cache->contents, getTagLocation(cache, blockNumber), cache->geometry.tagBits);
 }
 
 /*
@@ -101,7 +99,7 @@ uint32_t extractTag(cache_t* cache, uint32_t blockNumber) {
 	for the block specified.
 */
 uint32_t extractIndex(cache_t* cache, uint32_t blockNumber) {
-	return (uint32_t) (blockNumber >> log_2(cache->n));
+	return (uint32_t) (blockNumber >> cache->geometry.waysBits);
 }
 
 /*
@@ -110,10 +108,7 @@ uint32_t extractIndex(cache_t* cache, uint32_t blockNumber) {
 */
 uint32_t extractAddress(cache_t* cache, uint32_t tag, uint32_t blockNumber, uint32_t offset) {
 	uint32_t index = extractIndex(cache, blockNumber);
-	uint32_t offsetBits = (uint32_t) log_2(cache->blockDataSize);
-	uint32_t indexBits = (uint32_t) log_2(cache->totalDataSize / cache->blockDataSize / cache->n);
-
-	uint32_t addr = (tag << (offsetBits + indexBits)) + (index << offsetBits) + offset;
+	uint32_t addr = (tag << cache->geometry.tagShift) + (index << cache->geometry.indexShift) + offset;
 	return addr;
 }
 
@@ -123,9 +118,9 @@ uint32_t extractAddress(cache_t* cache, uint32_t tag, uint32_t blockNumber, uint
 	already in memory it should return the block at which this address's
 	operation would occur and indicates that this was a successful match.
 	If this address is not stored in the cache then it should point to the next
-	block that needs to be evicted as indicated by our LRU replacement system.
-	If there are multiple blocks that could be evicted selects the
-	block that occurs earlier in the cache. Returns a pointer to a struct
+	block that needs to be evicted as indicated by the replacement policy of
+	the cache. With LRU, if there are multiple blocks that could be evicted
+	selects the block that occurs earlier in the cache. Returns a pointer to a struct
 	which contains a block number, an LRU value, and whether or not the address
 	is already stored in the cache (is a match).
 */
@@ -135,52 +130,69 @@ evictionInfo_t* findEviction(cache_t* cache, uint32_t address) {
 	if (info == NULL) {
 		allocationFailed();
 	}
-	uint32_t numBlocksPerSet = cache->n;
-	long currLRU;
-	uint32_t addrIndex = getIndex(cache, address);
-
-	// Direct-mapped edge case
-	if (numBlocksPerSet == 1) {
-		info->blockNumber = addrIndex;
-		info->LRU = getLRU(cache, addrIndex);
-		if (tagEquals(addrIndex, getTag(cache, address), cache) == 1 && getValid(cache, addrIndex) == 1) {
-			info->match = true;
-		} else {
-			info->match = false;
-		}
-		return info;
-	}
+	*info = findEvictionInfo(cache, address);
+	return info;
+}
 
-	// Initiate on 0th block of index
-	uint32_t zeroth = addrIndex * numBlocksPerSet;
-	info->blockNumber = zeroth;
-	info->LRU = getLRU(cache, zeroth);
-	if (getValid(cache, zeroth) == 1 && tagEquals(zeroth, getTag(cache, address), cache) == 1 && addrIndex == extractIndex(cache, zeroth)) {
-		info->match = true;
-		return info;
-	} else {
-		info->match = false;
+/*
+	Works the same as findEviction but returns the evictionInfo struct by
+	value so that no memory has to be allocated or freed by the caller.
+	Only used by the paths that fill the block on a miss, since choosing
+	the block to evict can change the state of the replacement policy.
+*/
+evictionInfo_t findEvictionInfo(cache_t* cache, uint32_t address) {
+	evictionInfo_t info = lookupBlock(cache, address);
+	if (!info.match) {
+		info = chooseVictim(cache, address);
 	}
+	return info;
+}
 
-	// Iterate through remaining blocks
-	for (int i = 1; i < numBlocksPerSet; i++) {
-		// Return if the block is the same as addr info
-		if (getValid(cache, zeroth + i) == 1 && tagEquals(zeroth + i, getTag(cache, address), cache) == 1 && addrIndex == extractIndex(cache, zeroth + i)) {
-			info->blockNumber = zeroth + i;
-			info->LRU = getLRU(cache, zeroth + i);
-			info->match = true;
+/*
+	Takes in a cache and an address and looks for the address in the ways
+	of its set without changing the cache or its replacement policy. If a
+	block holds the address returns it as a match. Otherwise match is unset
+	and the block number is the first way of the set rather than the block
+	the replacement policy would evict.
+*/
+evictionInfo_t lookupBlock(cache_t* cache, uint32_t address) {
+	evictionInfo_t info;
+	uint32_t numBlocksPerSet = cache->n;
+	uint32_t addrTag = getTag(cache, address);
+	uint32_t zeroth = getIndex(cache, address) * numBlocksPerSet;
+	for (int i = 0; i < numBlocksPerSet; i++) {
+		if (getValid(cache, zeroth + i) == 1 && tagEquals(zeroth + i, addrTag, cache) == 1) {
+			info.blockNumber = zeroth + i;
+			info.LRU = getLRU(cache, zeroth + i);
+			info.match = true;
 			return info;
 		}
-		currLRU = getLRU(cache, zeroth + i);
-		if (currLRU > info->LRU) {
-			info->blockNumber = (uint32_t) (zeroth + i);
-			info->LRU = currLRU;
-			info->match = false;
-		}
 	}
-
+	info.blockNumber = zeroth;
+	info.LRU = getLRU(cache, zeroth);
+	info.match = false;
 	return info;
+}
+
+/*
+	Takes in a cache and an address that is not in the cache and returns
+	the block the replacement policy evicts to make room for it, which is
+	the only block of the set in a direct-mapped cache. Choosing a victim
+	can age the set or advance the random state of the policy, so it is
+	only called by the paths that then fill the block.
+*/
+evictionInfo_t chooseVictim(cache_t* cache, uint32_t address) {
+	evictionInfo_t info;
+	uint32_t addrIndex = getIndex(cache, address);
+	if (cache->n == 1) {
+		info.blockNumber = addrIndex;
+	} else {
+		info.blockNumber = addrIndex * cache->n + cache->policy->victim(cache, addrIndex);
 	}
+	info.LRU = getLRU(cache, info.blockNumber);
+	info.match = false;
+	return info;
+}
 
 /*
 	Takes in a cache and an address and returns the LRU
@@ -192,9 +204,9 @@ long getLRUAddress(cache_t* cache, uint32_t address){
 	uint32_t idx = getIndex(cache, address);
 	long tempLRU;
 	for (int i = 0; i < cache->n; i++) {
-		tempLRU = getLRU(cache, (idx << log_2(cache->n)) + i);
+		tempLRU = getLRU(cache, (idx << cache->geometry.waysBits) + i);
 		tag = getTag(cache, address);
-		if (tagEquals((idx << log_2(cache->n)) + i, tag, cache)) {
+		if (tagEquals((idx << cache->geometry.waysBits) + i, tag, cache)) {
 			return tempLRU;
 		}
 	}
@@ -209,27 +221,65 @@ long getLRUAddress(cache_t* cache, uint32_t address){
 */
 uint8_t* getData(cache_t* cache, uint32_t offset, uint32_t blockNumber, uint32_t size) {
 	uint8_t* data;
-	uint8_t mask;
-	uint64_t location = getDataLocation(cache, blockNumber, offset);
-	uint64_t byteLoc = location >> 3;
-	uint8_t shiftAmount = location & 7;
 	data = (uint8_t*) malloc(sizeof(uint8_t) * size);
 	if (data == NULL) {
 		allocationFailed();
 	}
+	getDataInto(cache, offset, blockNumber, size, data);
+	return data;
+}
+
+/*
+	Works the same as getData but copies the data that was read into the
+	buffer passed in, which must hold at least size bytes, instead of
+	allocating a new one.
+*/
+void getDataInto(cache_t* cache, uint32_t offset, uint32_t blockNumber, uint32_t size, uint8_t* data) {
+	uint64_t location;
+	uint64_t byteLoc;
+	uint8_t shiftAmount;
+	if (cache->layout == ALIGNED) {
+		memcpy(data, cache->data + ((uint64_t) blockNumber * cache->blockDataSize) + offset, size);
+		return;
+	}
+	location = getDataLocation(cache, blockNumber, offset);
+	byteLoc = location >> 3;
+	shiftAmount = location & 7;
 	if (shiftAmount == 0) {
-		for (uint32_t i = 0; i < size; i++) {
-			data[i] = cache->contents[byteLoc + i];
-		}
+		memcpy(data, cache->contents + byteLoc, size);
 	} else {
-		mask = 0;
-		for (uint8_t j = 0; j < shiftAmount; j++) {
-			mask += (1 << j);
-		}
-		for (uint32_t i = 0; i < size; i++) {
-			data[i] = cache->contents[byteLoc + i] << shiftAmount;
-			data[i] = data[i] | ((cache->contents[byteLoc + i + 1] >> (8 - shiftAmount)) & mask);
-		}
+		copyFromBitOffset(data, cache->contents + byteLoc, shiftAmount, size);
 	}
-	return data;
 }
+
+/*
+	Takes in an ALIGNED cache and a location in bits as it would be in a
+	PACKED cache with the same parameters and returns the value of the bit
+	stored for that location.
+*/
+uint8_t getAlignedBit(cache_t* cache, uint64_t location) {
+	uint64_t blockBits = cache->geometry.blockBits;
+	uint8_t lruBits = cache->geometry.lruBits;
+	uint8_t tagBits = cache->geometry.tagBits;
+	location -= cache->geometry.garbageBits;
+	uint32_t blockNumber = (uint32_t) (location / blockBits);
+	uint64_t bit = location % blockBits;
+	if (bit == 0) {
+		return getValid(cache, blockNumber);
+	} else if (bit == 1) {
+		return getDirty(cache, blockNumber);
+	} else if (bit == 2) {
+		return getShared(cache, blockNumber);
+	}
+	bit -= 3;
+	if (bit < lruBits) {
+		return (uint8_t) ((cache->LRU[blockNumber] >> (lruBits - 1 - bit)) & 1);
+	}
+	bit -= lruBits;
+	if (bit < tagBits) {
+		return (uint8_t) ((cache->tags[blockNumber] >> (tagBits - 1 - bit)) & 1);
+	}
+	bit -= tagBits;
+	uint8_t dataByte = cache->data[((uint64_t) blockNumber * cache->blockDataSize) + (bit >> 3)];
+	return (uint8_t) ((dataByte >> (7 - (bit & 7))) & 1);
+}
\ No newline at end of file
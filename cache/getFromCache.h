@@ -53,14 +53,40 @@ uint32_t extractAddress(cache_t* cache, uint32_t tag, uint32_t blockNumber, uint
 	already in memory it should return the block at which this address's
 	operation would occur and indicates that this was a successful match.
 	If this address is not stored in the cache then it should point to the next
-	block that needs to be evicted as indicated by our LRU replacement system.
-	If there are multiple blocks that could be evicted selects the
-	block that occurs earlier in the cache. Returns a pointer to a struct
+	block that needs to be evicted as indicated by the replacement policy of
+	the cache. With LRU, if there are multiple blocks that could be evicted
+	selects the block that occurs earlier in the cache. Returns a pointer to a struct
 	which contains a block number, an LRU value, and whether or not the address
 	is already stored in the cache (is a match).
 */
 evictionInfo_t* findEviction(cache_t* cache, uint32_t address);
 
+/*
+	Works the same as findEviction but returns the evictionInfo struct by
+	value so that no memory has to be allocated or freed by the caller.
+	Only used by the paths that fill the block on a miss, since choosing
+	the block to evict can change the state of the replacement policy.
+*/
+evictionInfo_t findEvictionInfo(cache_t* cache, uint32_t address);
+
+/*
+	Takes in a cache and an address and looks for the address in the ways
+	of its set without changing the cache or its replacement policy. If a
+	block holds the address returns it as a match. Otherwise match is unset
+	and the block number is the first way of the set rather than the block
+	the replacement policy would evict.
+*/
+evictionInfo_t lookupBlock(cache_t* cache, uint32_t address);
+
+/*
+	Takes in a cache and an address that is not in the cache and returns
+	the block the replacement policy evicts to make room for it, which is
+	the only block of the set in a direct-mapped cache. Choosing a victim
+	can age the set or advance the random state of the policy, so it is
+	only called by the paths that then fill the block.
+*/
+evictionInfo_t chooseVictim(cache_t* cache, uint32_t address);
+
 /*
 	Takes in a cache and an address and returns the LRU
 	value of that address in the cache. Used mostly for testing.
@@ -75,4 +101,18 @@ long getLRUAddress(cache_t* cache, uint32_t address);
 	higher up that calls this function.
 */
 uint8_t* getData(cache_t* cache, uint32_t offset, uint32_t blockNumber, uint32_t size);
+
+/*
+	Works the same as getData but copies the data that was read into the
+	buffer passed in, which must hold at least size bytes, instead of
+	allocating a new one.
+*/
+void getDataInto(cache_t* cache, uint32_t offset, uint32_t blockNumber, uint32_t size, uint8_t* data);
+
+/*
+	Takes in an ALIGNED cache and a location in bits as it would be in a
+	PACKED cache with the same parameters and returns the value of the bit
+	stored for that location.
+*/
+uint8_t getAlignedBit(cache_t* cache, uint64_t location);
 #endif
\ No newline at end of file
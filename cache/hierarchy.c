@@ -0,0 +1,326 @@
+/* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "memBackend.h"
+#include "hierarchy.h"
+#include "getFromCache.h"
+#include "setInCache.h"
+#include "cacheRead.h"
+#include "cacheWrite.h"
+#include "mem.h"
+#include "replacement.h"
+#include "prefetch.h"
+#include "sector.h"
+#include "../hitrate/hitRate.h"
+
+/*
+	Takes in a cache and a range of length bytes starting at address and
+	returns how many bytes of the range lie in the block of the cache that
+	holds address.
+*/
+static uint32_t chunkLength(cache_t* cache, uint32_t address, uint32_t length) {
+	uint32_t left = cache->blockDataSize - getOffset(cache, address);
+	return length < left ? length : left;
+}
+
+/*
+	Takes in a cache and a block number and invalidates the block without
+	writing it back.
+*/
+static void invalidateBlock(cache_t* cache, uint32_t blockNumber) {
+	setValid(cache, blockNumber, 0);
+	setDirty(cache, blockNumber, 0);
+	setShared(cache, blockNumber, 0);
+	cache->policy->onInvalidate(cache, blockNumber);
+	if (cache->sectorSize != 0) {
+		cache->sectorValid[blockNumber] = 0;
+		cache->sectorDirty[blockNumber] = 0;
+	}
+	if (cache->prefetcher != NULL) {
+		cache->prefetcher->marks[blockNumber] = 0;
+	}
+}
+
+/*
+	Takes in an exclusive cache, the address of a whole block, the data of
+	the block, and whether it is dirty, and places the block in the cache
+	after it was evicted from an upper level. The block replaces whatever
+	the replacement policy chooses if the cache does not hold it yet.
+*/
+static void installBlock(cache_t* cache, uint32_t address, uint8_t* data, uint8_t dirty) {
+	evictionInfo_t info = findEvictionInfo(cache, address);
+	uint32_t blockNum = info.blockNumber;
+	if (!info.match) {
+		if (cache->sectorSize != 0) {
+			allocateSectoredBlock(cache, blockNum, address);
+		} else {
+			evict(cache, blockNum);
+			setTag(cache, getTag(cache, address), blockNum);
+			setValid(cache, blockNum, 1);
+			setDirty(cache, blockNum, 0);
+			setShared(cache, blockNum, 0);
+		}
+	}
+	setData(cache, data, blockNum, cache->blockDataSize, 0);
+	markSectors(cache, blockNum, 0, cache->blockDataSize, dirty);
+	if (dirty) {
+		setDirty(cache, blockNum, 1);
+	}
+	if (info.match) {
+		cache->policy->onHit(cache, blockNum);
+	} else {
+		cache->policy->onFill(cache, blockNum);
+	}
+}
+
+/*
+	Takes in an exclusive cache and a range of length bytes inside of one
+	of its blocks that an upper level missed on. If the cache holds the
+	block the range is copied into data and the block leaves the cache,
+	being written below first if it is dirty. Otherwise the range is read
+	from the level below the cache without filling it.
+*/
+static void takeExclusiveBlock(cache_t* cache, uint32_t address, uint32_t length, uint8_t* data) {
+	evictionInfo_t info = lookupBlock(cache, address);
+	if (!info.match) {
+		cache->backend->ops->readBlock(cache->backend, address, length, data);
+		return;
+	}
+	uint32_t blockNum = info.blockNumber;
+	if (fillSectors(cache, blockNum, address, length, false)) {
+		reportHit(cache);
+	}
+	getDataInto(cache, getOffset(cache, address), blockNum, length, data);
+	if (getDirty(cache, blockNum)) {
+		uint32_t blockAddress = extractAddress(cache, extractTag(cache, blockNum), blockNum, 0);
+		if (cache->sectorSize != 0) {
+			writeBackSectors(cache, blockNum, blockAddress);
+		} else {
+			writeToMem(cache, blockNum, blockAddress);
+		}
+	}
+	invalidateBlock(cache, blockNum);
+}
+
+/*
+	Read block of a CACHE_BACKEND. Every block of the cache the range
+	touches is read through the cache as one access.
+*/
+static void cacheReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	cache_t* cache = backend->cache;
+	uint32_t done = 0;
+	while (done < length) {
+		uint32_t chunk = chunkLength(cache, address + done, length - done);
+		if (validAddresses(address + done, chunk) == 0) {
+			memset(data + done, 0, chunk);
+		} else if (cache->inclusion == EXCLUSIVE_LEVEL) {
+			takeExclusiveBlock(cache, address + done, chunk, data + done);
+			reportAccess(cache);
+		} else {
+			readFromCacheInto(cache, address + done, chunk, data + done);
+			reportAccess(cache);
+		}
+		done += chunk;
+	}
+}
+
+/*
+	Write block of a CACHE_BACKEND. Every block of the cache the range
+	touches is written through the cache as one access. An exclusive cache
+	takes whole blocks in as evictions from above and passes partial writes
+	of blocks it does not hold to the level below it.
+*/
+static void cacheWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	cache_t* cache = backend->cache;
+	uint32_t done = 0;
+	while (done < length) {
+		uint32_t chunk = chunkLength(cache, address + done, length - done);
+		if (validAddresses(address + done, chunk) == 0) {
+			done += chunk;
+			continue;
+		}
+		if (cache->inclusion != EXCLUSIVE_LEVEL) {
+			writeToCache(cache, address + done, data + done, chunk);
+			reportAccess(cache);
+		} else if (chunk == cache->blockDataSize) {
+			installBlock(cache, address + done, data + done, 1);
+		} else if (lookupBlock(cache, address + done).match) {
+			writeToCache(cache, address + done, data + done, chunk);
+			reportAccess(cache);
+		} else {
+			cache->backend->ops->writeBlock(cache->backend, address + done, chunk, data + done);
+		}
+		done += chunk;
+	}
+}
+
+/*
+	Flush of a CACHE_BACKEND. The dirty blocks of the cache stay in it and
+	only the writes the cache has made are flushed below it.
+*/
+static void cacheFlush(memBackend_t* backend) {
+	cache_t* cache = backend->cache;
+	cache->backend->ops->flush(cache->backend);
+}
+
+/*
+	Close of a CACHE_BACKEND. The cache can be given a new backend with a
+	different inclusion policy afterwards.
+*/
+static void cacheClose(memBackend_t* backend) {
+	backend->cache->levelBackend = NULL;
+}
+
+static const memBackendOps_t cacheOps = {cacheReadBlock, cacheWriteBlock, cacheFlush, cacheClose};
+
+/*
+	Takes in a cache that will be the next level below other caches and its
+	inclusion policy and returns a CACHE_BACKEND that reads and writes
+	through it. Caches created with the backend send their misses and write
+	backs to the cache instead of to physical memory and become its upper
+	levels. Every cache holds at most one such backend, so calling this
+	again returns the same backend with another reference. Returns NULL if
+	the cache already has a backend with a different inclusion policy or
+	is exclusive and has a victim cache.
+
+	A NINE_LEVEL cache is filled by the misses of its upper levels and its
+	evictions leave them alone. An INCLUSIVE_LEVEL cache is filled in the
+	same way but invalidates every copy of a block in its upper levels when
+	it evicts the block, so it always holds a superset of them. An
+	EXCLUSIVE_LEVEL cache is only filled by the evictions of its upper
+	levels and gives up a block when an upper level reads it, so a block is
+	never in both.
+
+	Upper levels must have a block size no larger than the cache, or the
+	same block size and no sectors if the cache is exclusive, and must be
+	deleted before the cache.
+*/
+memBackend_t* openCacheBackend(cache_t* cache, enum inclusion inclusion) {
+	if (cache == NULL) {
+		return NULL;
+	}
+	if (cache->levelBackend != NULL) {
+		if (cache->inclusion != inclusion) {
+			return NULL;
+		}
+		return retainMemBackend(cache->levelBackend);
+	}
+	if (inclusion == EXCLUSIVE_LEVEL && cache->victim != NULL) {
+		return NULL;
+	}
+	memBackend_t* backend = newMemBackend(CACHE_BACKEND, cache->physicalMemoryName);
+	backend->ops = &cacheOps;
+	backend->cache = cache;
+	cache->levelBackend = backend;
+	cache->inclusion = inclusion;
+	return backend;
+}
+
+/*
+	Takes in a cache that was just created and registers it as an upper
+	level of the cache below it if its backend is a CACHE_BACKEND. Returns
+	-1 if its block size does not fit the cache below it and 0 otherwise.
+	Called by createCache.
+*/
+int linkUpperLevel(cache_t* cache) {
+	if (cache->backend->type != CACHE_BACKEND) {
+		return 0;
+	}
+	cache_t* lower = cache->backend->cache;
+	if (cache->blockDataSize > lower->blockDataSize) {
+		return -1;
+	}
+	if (lower->inclusion == EXCLUSIVE_LEVEL && (cache->blockDataSize != lower->blockDataSize || cache->sectorSize != 0)) {
+		return -1;
+	}
+	cache_t** uppers = realloc(lower->uppers, sizeof(cache_t*) * (lower->numUppers + 1));
+	if (uppers == NULL) {
+		allocationFailed();
+	}
+	uppers[lower->numUppers] = cache;
+	lower->uppers = uppers;
+	lower->numUppers++;
+	return 0;
+}
+
+/*
+	Takes in a cache that is being deleted and removes it from the upper
+	levels of the cache below it. Called by deleteCache.
+*/
+void unlinkUpperLevel(cache_t* cache) {
+	if (cache->backend == NULL || cache->backend->type != CACHE_BACKEND) {
+		return;
+	}
+	cache_t* lower = cache->backend->cache;
+	for (uint32_t i = 0; i < lower->numUppers; i++) {
+		if (lower->uppers[i] == cache) {
+			lower->numUppers--;
+			lower->uppers[i] = lower->uppers[lower->numUppers];
+			return;
+		}
+	}
+}
+
+/*
+	Takes in a cache and the block number of a block it is evicting. If the
+	cache is inclusive every copy of the block in its upper levels, and in
+	theirs, is invalidated and dirty data in those copies is merged into the
+	block first so it is written back with it. Does nothing otherwise.
+*/
+void backInvalidate(cache_t* cache, uint32_t blockNumber) {
+	if (cache->numUppers == 0 || cache->inclusion != INCLUSIVE_LEVEL) {
+		return;
+	}
+	uint32_t address = extractAddress(cache, extractTag(cache, blockNumber), blockNumber, 0);
+	uint8_t* data = takeBlockBuffer(cache);
+	for (uint32_t i = 0; i < cache->numUppers; i++) {
+		cache_t* upper = cache->uppers[i];
+		uint32_t size = upper->blockDataSize;
+		for (uint32_t offset = 0; offset < cache->blockDataSize; offset += size) {
+			evictionInfo_t info = lookupBlock(upper, address + offset);
+			if (!info.match) {
+				continue;
+			}
+			uint32_t upperBlock = info.blockNumber;
+			backInvalidate(upper, upperBlock);
+			if (getDirty(upper, upperBlock)) {
+				// only the sectors that were written hold data newer than the block
+				uint64_t sectors = upper->sectorSize != 0 ? upper->sectorDirty[upperBlock] : 1;
+				uint32_t sectorSize = upper->sectorSize != 0 ? upper->sectorSize : size;
+				for (uint32_t j = 0; sectors != 0; j++, sectors >>= 1) {
+					if (sectors & 1) {
+						getDataInto(upper, j * sectorSize, upperBlock, sectorSize, data);
+						fillSectors(cache, blockNumber, address + offset + j * sectorSize, sectorSize, true);
+						setData(cache, data, blockNumber, sectorSize, offset + j * sectorSize);
+						markSectors(cache, blockNumber, offset + j * sectorSize, sectorSize, 1);
+					}
+				}
+				setDirty(cache, blockNumber, 1);
+			}
+			invalidateBlock(upper, upperBlock);
+			reportBackInvalidation(cache);
+		}
+	}
+	releaseBlockBuffer(cache);
+}
+
+/*
+	Takes in a cache and the block number of a valid block it is evicting.
+	If the level below it is exclusive the block is placed in that level,
+	dirty or clean, and 1 is returned. Returns 0 otherwise, in which case a
+	dirty block has to be written back as usual.
+*/
+int evictToLowerLevel(cache_t* cache, uint32_t blockNumber) {
+	if (cache->backend->type != CACHE_BACKEND || cache->backend->cache->inclusion != EXCLUSIVE_LEVEL) {
+		return 0;
+	}
+	uint8_t* data = takeBlockBuffer(cache);
+	uint32_t address = extractAddress(cache, extractTag(cache, blockNumber), blockNumber, 0);
+	fetchBlockInto(cache, blockNumber, data);
+	installBlock(cache->backend->cache, address, data, getDirty(cache, blockNumber));
+	releaseBlockBuffer(cache);
+	return 1;
+}
@@ -0,0 +1,59 @@
+/* Summer 2017 */
+#ifndef HIERARCHY_H
+#define HIERARCHY_H
+
+/*
+	Takes in a cache that will be the next level below other caches and its
+	inclusion policy and returns a CACHE_BACKEND that reads and writes
+	through it. Caches created with the backend send their misses and write
+	backs to the cache instead of to physical memory and become its upper
+	levels. Every cache holds at most one such backend, so calling this
+	again returns the same backend with another reference. Returns NULL if
+	the cache already has a backend with a different inclusion policy or
+	is exclusive and has a victim cache.
+
+	A NINE_LEVEL cache is filled by the misses of its upper levels and its
+	evictions leave them alone. An INCLUSIVE_LEVEL cache is filled in the
+	same way but invalidates every copy of a block in its upper levels when
+	it evicts the block, so it always holds a superset of them. An
+	EXCLUSIVE_LEVEL cache is only filled by the evictions of its upper
+	levels and gives up a block when an upper level reads it, so a block is
+	never in both.
+
+	Upper levels must have a block size no larger than the cache, or the
+	same block size and no sectors if the cache is exclusive, and must be
+	deleted before the cache.
+*/
+struct memBackend* openCacheBackend(cache_t* cache, enum inclusion inclusion);
+
+/*
+	Takes in a cache that was just created and registers it as an upper
+	level of the cache below it if its backend is a CACHE_BACKEND. Returns
+	-1 if its block size does not fit the cache below it and 0 otherwise.
+	Called by createCache.
+*/
+int linkUpperLevel(cache_t* cache);
+
+/*
+	Takes in a cache that is being deleted and removes it from the upper
+	levels of the cache below it. Called by deleteCache.
+*/
+void unlinkUpperLevel(cache_t* cache);
+
+/*
+	Takes in a cache and the block number of a block it is evicting. If the
+	cache is inclusive every copy of the block in its upper levels, and in
+	theirs, is invalidated and dirty data in those copies is merged into the
+	block first so it is written back with it. Does nothing otherwise.
+*/
+void backInvalidate(cache_t* cache, uint32_t blockNumber);
+
+/*
+	Takes in a cache and the block number of a valid block it is evicting.
+	If the level below it is exclusive the block is placed in that level,
+	dirty or clean, and 1 is returned. Returns 0 otherwise, in which case a
+	dirty block has to be written back as usual.
+*/
+int evictToLowerLevel(cache_t* cache, uint32_t blockNumber);
+
+#endif
@@ -1,50 +1,71 @@
 /* Summer 2017 */
 #include <stdio.h>
 #include <stdlib.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "utils.h"
 #include "cacheRead.h"
 #include "mem.h"
+#include "memBackend.h"
 
 /*
 	Takes in a cache and a memeory address that is not located in the current
 	cache and fetches it from main memory. 
 */
 uint8_t* readFromMem(cache_t* cache, uint32_t address) {
-	unsigned temp;
-	FILE* memory = fopen(cache->physicalMemoryName, "r");
 	uint8_t* data = malloc(sizeof(uint8_t) * cache->blockDataSize);
 	if (data == NULL) {
 		allocationFailed();
 	}
-	address = address - MIN_ADDRESS;
-	fseek(memory, 3 * address, SEEK_SET);
-	for (uint32_t i = 0; i < cache->blockDataSize; i++) {
-		fscanf(memory, "%x", &temp);
-		data[i] = (uint8_t) temp;
-	}
-	fclose(memory);
+	readFromMemInto(cache, address, data);
 	return data;
 }
 
+/*
+	Works the same as readFromMem but copies the block into the buffer passed
+	in, which must hold at least blockDataSize bytes, instead of allocating
+	a new one.
+*/
+void readFromMemInto(cache_t* cache, uint32_t address, uint8_t* data) {
+	cache->backend->ops->readBlock(cache->backend, address, cache->blockDataSize, data);
+}
+
 /*
 	Takes in a cache, a block number, and an address and writes the data in the
 	block specified to phsyical memory at the address indicated.
 */
 void writeToMem(cache_t* cache, uint32_t blockNumber, uint32_t address) {
-	uint8_t* data = fetchBlock(cache, blockNumber);
-	FILE* physicalMemory = fopen(cache->physicalMemoryName, "r+");
-	address = address - MIN_ADDRESS;
-	fseek(physicalMemory, 3 * address, SEEK_SET);
-	for (int i = 0; i < cache->blockDataSize; i++) {
-		if (data[i] < 16) {
-			fprintf(physicalMemory, "0");
-		}
-		fprintf(physicalMemory, "%x ", data[i]);
-	}
-	fclose(physicalMemory);
-	free(data);
+	uint8_t* data = takeBlockBuffer(cache);
+	fetchBlockInto(cache, blockNumber, data);
+	cache->backend->ops->writeBlock(cache->backend, address, cache->blockDataSize, data);
+	releaseBlockBuffer(cache);
+}
+
+/*
+	Takes in a cache, an address, a pointer to data, and a length in bytes
+	and reads that many bytes of physical memory starting at the address
+	into data. Used to read part of a block.
+*/
+void readBytesFromMem(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length) {
+	cache->backend->ops->readBlock(cache->backend, address, length, data);
+}
+
+/*
+	Takes in a cache, an address, a pointer to data, and a length in bytes
+	and writes the data to physical memory starting at the address. Used to
+	write several adjacent blocks or part of a block at once.
+*/
+void writeBytesToMem(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length) {
+	cache->backend->ops->writeBlock(cache->backend, address, length, data);
+}
+
+/*
+	Takes in a cache and forces every write back it has made, including any
+	held in a write back buffer, into its physical memory.
+*/
+void flushMem(cache_t* cache) {
+	cache->backend->ops->flush(cache->backend);
 }
 
 /*
@@ -59,4 +80,71 @@ int validAddresses(uint32_t address, uint32_t length) {
 		return 0;
 	}
 	return 1;
+}
+
+/*
+	Takes in the name of a physical memory text file and the name of a binary
+	memory image to create and converts the text file into the image. Bytes
+	missing from the end of the text file are set to 0. Returns 0 on success
+	and -1 if either file cannot be opened.
+*/
+int textToMemoryImage(char* textName, char* imageName) {
+	unsigned temp;
+	memoryImageHeader_t header;
+	uint32_t size = MEMORY_SIZE;
+	FILE* text = fopen(textName, "r");
+	if (text == NULL) {
+		return -1;
+	}
+	FILE* image = fopen(imageName, "wb");
+	if (image == NULL) {
+		fclose(text);
+		return -1;
+	}
+	uint8_t* data = calloc(size, sizeof(uint8_t));
+	if (data == NULL) {
+		allocationFailed();
+	}
+	for (uint32_t i = 0; i < size && fscanf(text, "%x", &temp) == 1; i++) {
+		data[i] = (uint8_t) temp;
+	}
+	memcpy(header.magic, MEMORY_IMAGE_MAGIC, 8);
+	header.baseAddress = MIN_ADDRESS;
+	header.size = size;
+	fwrite(&header, sizeof(header), 1, image);
+	fwrite(data, sizeof(uint8_t), size, image);
+	free(data);
+	fclose(text);
+	fclose(image);
+	return 0;
+}
+
+/*
+	Takes in the name of a binary memory image and the name of a physical
+	memory text file to create and converts the image into the text file.
+	Returns 0 on success and -1 if either file cannot be opened or the image
+	is invalid.
+*/
+int memoryImageToText(char* imageName, char* textName) {
+	int c;
+	memoryImageHeader_t header;
+	FILE* image = fopen(imageName, "rb");
+	if (image == NULL) {
+		return -1;
+	}
+	if (fread(&header, sizeof(header), 1, image) != 1 || memcmp(header.magic, MEMORY_IMAGE_MAGIC, 8)) {
+		fclose(image);
+		return -1;
+	}
+	FILE* text = fopen(textName, "w");
+	if (text == NULL) {
+		fclose(image);
+		return -1;
+	}
+	for (uint32_t i = 0; i < header.size && (c = fgetc(image)) != EOF; i++) {
+		fprintf(text, "%02x ", c);
+	}
+	fclose(image);
+	fclose(text);
+	return 0;
 }
\ No newline at end of file
@@ -3,6 +3,21 @@
 #define MEM_H
 #define MIN_ADDRESS 0x61c00000
 #define MAX_ADDRESS 0x61cfffff
+#define MEMORY_SIZE (MAX_ADDRESS - MIN_ADDRESS + 1)
+#define MEMORY_IMAGE_MAGIC "LCMEMIMG"
+
+/*
+	Struct used as the header of a binary memory image. The magic holds
+	MEMORY_IMAGE_MAGIC, the base address is the address of the first byte
+	of data, and the size is the number of data bytes that follow the
+	header. One byte of data is stored per address.
+*/
+typedef struct memoryImageHeader
+{
+	char magic[8];
+	uint32_t baseAddress;
+	uint32_t size;
+} memoryImageHeader_t;
 
 /*
 	Takes in a cache and a memeory address that is not located in the current
@@ -10,12 +25,39 @@
 */
 uint8_t* readFromMem(cache_t* cache, uint32_t address);
 
+/*
+	Works the same as readFromMem but copies the block into the buffer passed
+	in, which must hold at least blockDataSize bytes, instead of allocating
+	a new one.
+*/
+void readFromMemInto(cache_t* cache, uint32_t address, uint8_t* data);
+
 /*
 	Takes in a cache, a block number, and an address and writes the data in the
 	block specified to phsyical memory at the address indicated.
 */
 void writeToMem(cache_t* cache, uint32_t blockNumber, uint32_t address);
 
+/*
+	Takes in a cache, an address, a pointer to data, and a length in bytes
+	and reads that many bytes of physical memory starting at the address
+	into data. Used to read part of a block.
+*/
+void readBytesFromMem(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length);
+
+/*
+	Takes in a cache, an address, a pointer to data, and a length in bytes
+	and writes the data to physical memory starting at the address. Used to
+	write several adjacent blocks or part of a block at once.
+*/
+void writeBytesToMem(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length);
+
+/*
+	Takes in a cache and forces every write back it has made, including any
+	held in a write back buffer, into its physical memory.
+*/
+void flushMem(cache_t* cache);
+
 /*
 	Takes in an address and a size that will be requested and determines
 	whether or not that memory is accessible. Returns 1 if the memory is
@@ -23,4 +65,20 @@ void writeToMem(cache_t* cache, uint32_t blockNumber, uint32_t address);
 */
 int validAddresses(uint32_t address, uint32_t length);
 
+/*
+	Takes in the name of a physical memory text file and the name of a binary
+	memory image to create and converts the text file into the image. Bytes
+	missing from the end of the text file are set to 0. Returns 0 on success
+	and -1 if either file cannot be opened.
+*/
+int textToMemoryImage(char* textName, char* imageName);
+
+/*
+	Takes in the name of a binary memory image and the name of a physical
+	memory text file to create and converts the image into the text file.
+	Returns 0 on success and -1 if either file cannot be opened or the image
+	is invalid.
+*/
+int memoryImageToText(char* imageName, char* textName);
+
 #endif
\ No newline at end of file
@@ -0,0 +1,475 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include "utils.h"
+#include "mem.h"
+#include "memBackend.h"
+#include "writeBuffer.h"
+
+/*
+	List of every backend that was opened by name and is still referenced.
+*/
+static memBackend_t* openBackends = NULL;
+
+/*
+	Takes in the name of a binary memory image and the flags to open it with
+	and returns a file descriptor for it with the image length stored in
+	length. Returns -1 if the file cannot be opened, is not an image, or does
+	not cover every valid address.
+*/
+static int openMemoryImage(char* name, int flags, uint64_t* length) {
+	memoryImageHeader_t header;
+	struct stat info;
+	int fd = open(name, flags);
+	if (fd == -1) {
+		return -1;
+	}
+	if (read(fd, &header, sizeof(header)) != sizeof(header) || memcmp(header.magic, MEMORY_IMAGE_MAGIC, 8)
+		|| header.baseAddress != MIN_ADDRESS || header.size < MEMORY_SIZE
+		|| fstat(fd, &info) == -1 || (uint64_t) info.st_size < sizeof(header) + (uint64_t) header.size) {
+		close(fd);
+		return -1;
+	}
+	*length = sizeof(header) + (uint64_t) header.size;
+	return fd;
+}
+
+/*
+	Reads a block from a text file of hex bytes. Each byte takes up 3
+	characters so the file is opened and searched on every access.
+*/
+static void textReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	unsigned temp;
+	FILE* memory = fopen(backend->name, "r");
+	address = address - MIN_ADDRESS;
+	fseek(memory, 3 * address, SEEK_SET);
+	for (uint32_t i = 0; i < length; i++) {
+		fscanf(memory, "%x", &temp);
+		data[i] = (uint8_t) temp;
+	}
+	fclose(memory);
+}
+
+/*
+	Writes a block to a text file of hex bytes.
+*/
+static void textWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	FILE* physicalMemory = fopen(backend->name, "r+");
+	address = address - MIN_ADDRESS;
+	fseek(physicalMemory, 3 * address, SEEK_SET);
+	for (uint32_t i = 0; i < length; i++) {
+		if (data[i] < 16) {
+			fprintf(physicalMemory, "0");
+		}
+		fprintf(physicalMemory, "%x ", data[i]);
+	}
+	fclose(physicalMemory);
+}
+
+/*
+	A text file is closed after every access so there is nothing to flush
+	or close.
+*/
+static void textFlush(memBackend_t* backend) {
+	(void) backend;
+}
+
+static void textClose(memBackend_t* backend) {
+	(void) backend;
+}
+
+/*
+	Reads a block from a binary memory image with a single pread. Nothing is
+	buffered, so every block read is a system call.
+*/
+static void binaryReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		memset(data, 0, length);
+		return;
+	}
+	off_t position = sizeof(memoryImageHeader_t) + (off_t) (address - MIN_ADDRESS);
+	if (pread(backend->fd, data, length, position) != (ssize_t) length) {
+		memset(data, 0, length);
+	}
+}
+
+/*
+	Writes a block to a binary memory image with a single pwrite.
+*/
+static void binaryWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		return;
+	}
+	off_t position = sizeof(memoryImageHeader_t) + (off_t) (address - MIN_ADDRESS);
+	if (pwrite(backend->fd, data, length, position) != (ssize_t) length) {
+		fprintf(stderr, "\nError: write to physical memory failed\n");
+	}
+}
+
+/*
+	Forces the writes made to a binary memory image onto the disk.
+*/
+static void binaryFlush(memBackend_t* backend) {
+	fdatasync(backend->fd);
+}
+
+/*
+	Closes the file descriptor of a binary memory image.
+*/
+static void binaryClose(memBackend_t* backend) {
+	close(backend->fd);
+	backend->fd = -1;
+}
+
+/*
+	Reads a block from a mapped binary memory image.
+*/
+static void mmapReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		memset(data, 0, length);
+		return;
+	}
+	memcpy(data, backend->memory + sizeof(memoryImageHeader_t) + (address - MIN_ADDRESS), length);
+}
+
+/*
+	Writes a block to a mapped binary memory image.
+*/
+static void mmapWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		return;
+	}
+	memcpy(backend->memory + sizeof(memoryImageHeader_t) + (address - MIN_ADDRESS), data, length);
+}
+
+/*
+	Forces the writes made to a mapped binary memory image onto the disk.
+*/
+static void mmapFlush(memBackend_t* backend) {
+	msync(backend->memory, backend->length, MS_SYNC);
+}
+
+/*
+	Unmaps a binary memory image. Anything written to it is kept in the file.
+*/
+static void mmapClose(memBackend_t* backend) {
+	munmap(backend->memory, backend->length);
+	backend->memory = NULL;
+}
+
+/*
+	Reads a block from an arena.
+*/
+static void arenaReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		memset(data, 0, length);
+		return;
+	}
+	memcpy(data, backend->memory + (address - MIN_ADDRESS), length);
+}
+
+/*
+	Writes a block to an arena.
+*/
+static void arenaWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (validAddresses(address, length) == 0) {
+		return;
+	}
+	memcpy(backend->memory + (address - MIN_ADDRESS), data, length);
+}
+
+/*
+	An arena has no file so there is nothing to flush.
+*/
+static void arenaFlush(memBackend_t* backend) {
+	(void) backend;
+}
+
+/*
+	Frees the memory of an arena.
+*/
+static void arenaClose(memBackend_t* backend) {
+	free(backend->memory);
+	backend->memory = NULL;
+}
+
+/*
+	Reads a block through a write back buffer. A block held by a single run
+	is copied from the buffer and anything else is read from the inner
+	backend with the buffered bytes copied over it.
+*/
+static void bufferedReadBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (readWriteBuffer(backend->buffer, address, length, data)) {
+		return;
+	}
+	backend->inner->ops->readBlock(backend->inner, address, length, data);
+	overlayWriteBuffer(backend->buffer, address, length, data);
+}
+
+/*
+	Writes a block into a write back buffer and drains the buffer into the
+	inner backend if it is over capacity.
+*/
+static void bufferedWriteBlock(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data) {
+	if (insertWriteBuffer(backend->buffer, address, length, data)) {
+		drainWriteBuffer(backend->buffer, backend->inner);
+	}
+}
+
+/*
+	Drains a write back buffer and flushes the inner backend.
+*/
+static void bufferedFlush(memBackend_t* backend) {
+	drainWriteBuffer(backend->buffer, backend->inner);
+	backend->inner->ops->flush(backend->inner);
+}
+
+/*
+	Drains and frees a write back buffer and drops the reference to the
+	inner backend.
+*/
+static void bufferedClose(memBackend_t* backend) {
+	drainWriteBuffer(backend->buffer, backend->inner);
+	deleteWriteBuffer(backend->buffer);
+	backend->buffer = NULL;
+	releaseMemBackend(backend->inner);
+	backend->inner = NULL;
+}
+
+static const memBackendOps_t textOps = {textReadBlock, textWriteBlock, textFlush, textClose};
+static const memBackendOps_t binaryOps = {binaryReadBlock, binaryWriteBlock, binaryFlush, binaryClose};
+static const memBackendOps_t mmapOps = {mmapReadBlock, mmapWriteBlock, mmapFlush, mmapClose};
+static const memBackendOps_t arenaOps = {arenaReadBlock, arenaWriteBlock, arenaFlush, arenaClose};
+static const memBackendOps_t bufferedOps = {bufferedReadBlock, bufferedWriteBlock, bufferedFlush, bufferedClose};
+
+/*
+	Takes in the name of a file and copies its contents into the memory of
+	an arena, which must hold MEMORY_SIZE bytes. Bytes missing from the end
+	of the file are left at 0. Returns 0 on success and -1 if the file cannot
+	be opened or is an invalid image.
+*/
+static int loadArena(uint8_t* memory, char* name) {
+	unsigned temp;
+	uint64_t length;
+	if (isMemoryImage(name)) {
+		int fd = openMemoryImage(name, O_RDONLY, &length);
+		if (fd == -1) {
+			return -1;
+		}
+		if (pread(fd, memory, MEMORY_SIZE, sizeof(memoryImageHeader_t)) != MEMORY_SIZE) {
+			close(fd);
+			return -1;
+		}
+		close(fd);
+		return 0;
+	}
+	FILE* text = fopen(name, "r");
+	if (text == NULL) {
+		return -1;
+	}
+	for (uint32_t i = 0; i < MEMORY_SIZE && fscanf(text, "%x", &temp) == 1; i++) {
+		memory[i] = (uint8_t) temp;
+	}
+	fclose(text);
+	return 0;
+}
+
+/*
+	Takes in a type and a name and allocates a backend with one reference
+	and nothing opened yet. Used by backends that are set up outside of
+	memBackend.c, which must fill in the ops.
+*/
+memBackend_t* newMemBackend(enum memBackendType type, char* name) {
+	memBackend_t* backend = malloc(sizeof(memBackend_t));
+	if (backend == NULL) {
+		allocationFailed();
+	}
+	backend->name = malloc(sizeof(char) * strlen(name) + 1);
+	if (backend->name == NULL) {
+		free(backend);
+		allocationFailed();
+	}
+	strcpy(backend->name, name);
+	backend->type = type;
+	backend->references = 1;
+	backend->fd = -1;
+	backend->memory = NULL;
+	backend->length = 0;
+	backend->inner = NULL;
+	backend->buffer = NULL;
+	backend->cache = NULL;
+	backend->next = NULL;
+	return backend;
+}
+
+/*
+	Takes in the name of a physical memory file and the type of backend to
+	use and returns a backend for it. If a backend of that type is already
+	open for the file it is returned with another reference instead of
+	opening the file again. A binary type requires the file to be a binary
+	memory image that covers every valid address and an ARENA_BACKEND copies
+	a text file or an image into its arena once. A BUFFERED_BACKEND puts a
+	write back buffer of DEFAULT_WRITE_BUFFER_SIZE bytes in front of a
+	BINARY_BACKEND for an image and a TEXT_BACKEND for anything else.
+	Returns NULL if the file cannot be opened or is not a valid image.
+*/
+memBackend_t* openMemBackend(char* name, enum memBackendType type) {
+	if (name == NULL) {
+		return NULL;
+	}
+	if (type == AUTO_BACKEND) {
+		type = isMemoryImage(name) ? MMAP_BACKEND : BUFFERED_BACKEND;
+	}
+	for (memBackend_t* open = openBackends; open != NULL; open = open->next) {
+		if (open->type == type && !strcmp(open->name, name)) {
+			return retainMemBackend(open);
+		}
+	}
+	if (access(name, F_OK) == -1) {
+		return NULL;
+	}
+	memBackend_t* backend;
+	if (type == BUFFERED_BACKEND) {
+		memBackend_t* inner = openMemBackend(name, isMemoryImage(name) ? BINARY_BACKEND : TEXT_BACKEND);
+		if (inner == NULL) {
+			return NULL;
+		}
+		backend = createBufferedBackend(inner, DEFAULT_WRITE_BUFFER_SIZE);
+		releaseMemBackend(inner);
+		backend->next = openBackends;
+		openBackends = backend;
+		return backend;
+	}
+	backend = newMemBackend(type, name);
+	if (type == TEXT_BACKEND) {
+		backend->ops = &textOps;
+	} else if (type == BINARY_BACKEND) {
+		backend->ops = &binaryOps;
+		backend->fd = openMemoryImage(name, O_RDWR, &(backend->length));
+		if (backend->fd == -1) {
+			free(backend->name);
+			free(backend);
+			return NULL;
+		}
+	} else if (type == MMAP_BACKEND) {
+		backend->ops = &mmapOps;
+		int fd = openMemoryImage(name, O_RDWR, &(backend->length));
+		void* map = fd == -1 ? MAP_FAILED : mmap(NULL, backend->length, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+		if (fd != -1) {
+			close(fd);
+		}
+		if (map == MAP_FAILED) {
+			free(backend->name);
+			free(backend);
+			return NULL;
+		}
+		backend->memory = (uint8_t*) map;
+	} else {
+		backend->ops = &arenaOps;
+		backend->length = MEMORY_SIZE;
+		backend->memory = calloc(MEMORY_SIZE, sizeof(uint8_t));
+		if (backend->memory == NULL) {
+			free(backend->name);
+			free(backend);
+			allocationFailed();
+		}
+		if (loadArena(backend->memory, name) == -1) {
+			free(backend->memory);
+			free(backend->name);
+			free(backend);
+			return NULL;
+		}
+	}
+	backend->next = openBackends;
+	openBackends = backend;
+	return backend;
+}
+
+/*
+	Creates an ARENA_BACKEND that is not backed by any file with every
+	byte of physical memory set to 0. It is never shared by name.
+*/
+memBackend_t* createArenaBackend() {
+	memBackend_t* backend = newMemBackend(ARENA_BACKEND, "arena");
+	backend->ops = &arenaOps;
+	backend->length = MEMORY_SIZE;
+	backend->memory = calloc(MEMORY_SIZE, sizeof(uint8_t));
+	if (backend->memory == NULL) {
+		free(backend->name);
+		free(backend);
+		allocationFailed();
+	}
+	return backend;
+}
+
+/*
+	Takes in a backend and a capacity in bytes and creates a BUFFERED_BACKEND
+	in front of it. Dirty blocks written to the new backend are merged in a
+	write back buffer and reach the inner backend in address order when the
+	buffer is full or the backend is flushed. Reads of buffered data are
+	served from the buffer. The new backend takes its own reference to the
+	inner backend and is never shared by name. Returns NULL if the capacity
+	is 0.
+*/
+memBackend_t* createBufferedBackend(memBackend_t* backend, uint32_t capacity) {
+	if (backend == NULL || capacity == 0) {
+		return NULL;
+	}
+	memBackend_t* buffered = newMemBackend(BUFFERED_BACKEND, backend->name);
+	buffered->ops = &bufferedOps;
+	buffered->buffer = createWriteBuffer(capacity);
+	buffered->inner = retainMemBackend(backend);
+	return buffered;
+}
+
+/*
+	Takes in a backend and adds a reference to it. Returns the backend.
+*/
+memBackend_t* retainMemBackend(memBackend_t* backend) {
+	if (backend != NULL) {
+		backend->references++;
+	}
+	return backend;
+}
+
+/*
+	Takes in a backend and drops a reference to it. When the last reference
+	is dropped the backend is flushed, closed, and freed.
+*/
+void releaseMemBackend(memBackend_t* backend) {
+	if (backend == NULL || --(backend->references) > 0) {
+		return;
+	}
+	for (memBackend_t** link = &openBackends; *link != NULL; link = &((*link)->next)) {
+		if (*link == backend) {
+			*link = backend->next;
+			break;
+		}
+	}
+	backend->ops->flush(backend);
+	backend->ops->close(backend);
+	free(backend->name);
+	free(backend);
+}
+
+/*
+	Takes in the name of a file and returns 1 if it is a binary memory
+	image and 0 otherwise.
+*/
+int isMemoryImage(char* name) {
+	char magic[8];
+	FILE* file = fopen(name, "rb");
+	if (file == NULL) {
+		return 0;
+	}
+	int image = fread(magic, sizeof(char), 8, file) == 8 && !memcmp(magic, MEMORY_IMAGE_MAGIC, 8);
+	fclose(file);
+	return image;
+}
@@ -0,0 +1,124 @@
+/* Summer 2017 */
+#ifndef MEMBACKEND_H
+#define MEMBACKEND_H
+
+/*
+	Enum used to select how physical memory is stored. TEXT_BACKEND is the
+	original text file of hex bytes that is opened on every access.
+	BINARY_BACKEND keeps a binary memory image open and makes one pread or
+	pwrite per block with no buffering of its own. MMAP_BACKEND maps a
+	binary memory image into memory once. ARENA_BACKEND holds all of
+	physical memory in a malloced arena and never touches a file after it
+	is created. BUFFERED_BACKEND holds writes in a write back buffer in
+	front of another backend. CACHE_BACKEND reads and writes through the
+	next level of a cache hierarchy. AUTO_BACKEND uses MMAP_BACKEND for
+	binary memory images and a BUFFERED_BACKEND in front of a TEXT_BACKEND
+	for everything else.
+*/
+enum memBackendType {AUTO_BACKEND, TEXT_BACKEND, BINARY_BACKEND, MMAP_BACKEND, ARENA_BACKEND, BUFFERED_BACKEND,
+	CACHE_BACKEND};
+
+/*
+	Capacity in bytes of the write back buffer a BUFFERED_BACKEND opened by
+	name holds in front of its file.
+*/
+#define DEFAULT_WRITE_BUFFER_SIZE 4096
+
+typedef struct memBackend memBackend_t;
+
+/*
+	Struct used to hold the operations of a backend. Read block copies
+	length bytes starting at address into data and write block copies length
+	bytes from data into physical memory at address. Flush forces every
+	write made so far into the underlying file and close releases whatever
+	the backend holds open. Addresses that are not valid read as 0 and
+	writes to them are dropped, except in a TEXT_BACKEND which keeps the
+	original behavior.
+*/
+typedef struct memBackendOps
+{
+	void (*readBlock)(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data);
+	void (*writeBlock)(memBackend_t* backend, uint32_t address, uint32_t length, uint8_t* data);
+	void (*flush)(memBackend_t* backend);
+	void (*close)(memBackend_t* backend);
+} memBackendOps_t;
+
+/*
+	Struct used to represent one physical memory. Every cache that reads
+	and writes the same memory holds a reference to the same backend, so two
+	caches share main memory exactly when their backends are the same
+	pointer. The name is the file the backend was opened from. The fd,
+	memory, inner, buffer, and cache fields are only used by the backend
+	types that need them and the next field links the backends opened by
+	name so they can be shared.
+*/
+struct memBackend
+{
+	const memBackendOps_t* ops;
+	enum memBackendType type;
+	char* name;
+	uint32_t references;
+	int fd;
+	uint8_t* memory;
+	uint64_t length;
+	memBackend_t* inner;
+	struct writeBuffer* buffer;
+	struct cache* cache;
+	memBackend_t* next;
+};
+
+/*
+	Takes in a type and a name and allocates a backend with one reference
+	and nothing opened yet. Used by backends that are set up outside of
+	memBackend.c, which must fill in the ops.
+*/
+memBackend_t* newMemBackend(enum memBackendType type, char* name);
+
+/*
+	Takes in the name of a physical memory file and the type of backend to
+	use and returns a backend for it. If a backend of that type is already
+	open for the file it is returned with another reference instead of
+	opening the file again. A binary type requires the file to be a binary
+	memory image that covers every valid address and an ARENA_BACKEND copies
+	a text file or an image into its arena once. A BUFFERED_BACKEND puts a
+	write back buffer of DEFAULT_WRITE_BUFFER_SIZE bytes in front of a
+	BINARY_BACKEND for an image and a TEXT_BACKEND for anything else.
+	Returns NULL if the file cannot be opened or is not a valid image.
+*/
+memBackend_t* openMemBackend(char* name, enum memBackendType type);
+
+/*
+	Creates an ARENA_BACKEND that is not backed by any file with every
+	byte of physical memory set to 0. It is never shared by name.
+*/
+memBackend_t* createArenaBackend();
+
+/*
+	Takes in a backend and a capacity in bytes and creates a BUFFERED_BACKEND
+	in front of it. Dirty blocks written to the new backend are merged in a
+	write back buffer and reach the inner backend in address order when the
+	buffer is full or the backend is flushed. Reads of buffered data are
+	served from the buffer. The new backend takes its own reference to the
+	inner backend and is never shared by name. Returns NULL if the capacity
+	is 0.
+*/
+memBackend_t* createBufferedBackend(memBackend_t* backend, uint32_t capacity);
+
+/*
+	Takes in a backend and adds a reference to it. Returns the backend.
+*/
+memBackend_t* retainMemBackend(memBackend_t* backend);
+
+/*
+	Takes in a backend and drops a reference to it. When the last reference
+	is dropped the backend is flushed, closed, and freed.
+*/
+void releaseMemBackend(memBackend_t* backend);
+
+/*
+	Takes in the name of a file and returns 1 if it is a binary memory
+	image and 0 otherwise.
+*/
+int isMemoryImage(char* name);
+
+#endif
@@ -0,0 +1,31 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "mem.h"
+
+/*
+	Converts between physical memory text files and binary memory images.
+	Usage: memConvert -b text image   converts a text file into an image
+	       memConvert -t image text   converts an image into a text file
+*/
+int main(int argc, char** argv) {
+	int result;
+	if (argc != 4 || (strcmp(argv[1], "-b") && strcmp(argv[1], "-t"))) {
+		fprintf(stderr, "usage: %s -b text image | -t image text\n", argv[0]);
+		return 1;
+	}
+	if (!strcmp(argv[1], "-b")) {
+		result = textToMemoryImage(argv[2], argv[3]);
+	} else {
+		result = memoryImageToText(argv[2], argv[3]);
+	}
+	if (result == -1) {
+		physicalMemFailed();
+		return 1;
+	}
+	return 0;
+}
@@ -0,0 +1,261 @@
+/* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "prefetch.h"
+#include "getFromCache.h"
+#include "setInCache.h"
+#include "cacheRead.h"
+#include "cacheWrite.h"
+#include "mem.h"
+#include "replacement.h"
+#include "sector.h"
+
+/*
+	Takes in a cache and the address of a block and places the block in the
+	cache in the same way as a read miss unless it is already there. The
+	block is marked as prefetched and a prefetched block that is evicted
+	for it without being used is counted as polluting.
+*/
+static void fillPrefetch(cache_t* cache, uint32_t address) {
+	prefetcher_t* prefetcher = cache->prefetcher;
+	evictionInfo_t info = findEvictionInfo(cache, address);
+	if (info.match) {
+		return;
+	}
+	uint32_t blockNum = info.blockNumber;
+	if (prefetcher->marks[blockNum] && getValid(cache, blockNum)) {
+		prefetcher->polluting++;
+	}
+	if (cache->sectorSize != 0) {
+		allocateSectoredBlock(cache, blockNum, address);
+		fillSectors(cache, blockNum, address, cache->blockDataSize, false);
+		cache->policy->onFill(cache, blockNum);
+	} else {
+		uint8_t* block = takeBlockBuffer(cache);
+		uint32_t tag = getTag(cache, address);
+		uint8_t dirty = fetchMissedBlock(cache, blockNum, address, block);
+		writeDataToCache(cache, address, block, cache->blockDataSize, &info);
+		releaseBlockBuffer(cache);
+		setDirty(cache, blockNum, dirty);
+		setTag(cache, tag, blockNum);
+	}
+	prefetcher->marks[blockNum] = 1;
+	prefetcher->filled++;
+}
+
+/*
+	Takes in a cache and the address of a block and issues a prefetch for
+	it. Without a latency the block is filled at once and otherwise it waits
+	in the pending queue. Addresses that are not valid are ignored.
+*/
+static void issuePrefetch(cache_t* cache, uint32_t address) {
+	prefetcher_t* prefetcher = cache->prefetcher;
+	if (validAddresses(address, cache->blockDataSize) == 0) {
+		return;
+	}
+	if (prefetcher->latency == 0) {
+		prefetcher->issued++;
+		fillPrefetch(cache, address);
+		return;
+	}
+	for (uint32_t i = 0; i < prefetcher->numPending; i++) {
+		if (prefetcher->pendingAddresses[i] == address) {
+			return;
+		}
+	}
+	if (prefetcher->numPending == PREFETCH_QUEUE) {
+		prefetcher->dropped++;
+		return;
+	}
+	prefetcher->issued++;
+	prefetcher->pendingAddresses[prefetcher->numPending] = address;
+	prefetcher->pendingDue[prefetcher->numPending] = prefetcher->clock + prefetcher->latency;
+	prefetcher->numPending++;
+}
+
+/*
+	Takes in a prefetcher and removes the pending prefetch at the index
+	given, keeping the rest of the queue in the order they were issued.
+*/
+static void removePending(prefetcher_t* prefetcher, uint32_t index) {
+	prefetcher->numPending--;
+	memmove(&(prefetcher->pendingAddresses[index]), &(prefetcher->pendingAddresses[index + 1]), sizeof(uint32_t) * (prefetcher->numPending - index));
+	memmove(&(prefetcher->pendingDue[index]), &(prefetcher->pendingDue[index + 1]), sizeof(uint64_t) * (prefetcher->numPending - index));
+}
+
+/*
+	Takes in a cache and the address of the block that was just accessed and
+	returns the stream of its region, replacing the oldest stream if the
+	region is not tracked yet. Sets found to whether the region was tracked.
+*/
+static prefetchStream_t* findStream(cache_t* cache, uint32_t block, bool* found) {
+	prefetcher_t* prefetcher = cache->prefetcher;
+	uint32_t region = block >> PREFETCH_REGION_BITS;
+	prefetchStream_t* oldest = &(prefetcher->streams[0]);
+	for (uint32_t i = 0; i < PREFETCH_STREAMS; i++) {
+		prefetchStream_t* stream = &(prefetcher->streams[i]);
+		if (stream->valid && stream->region == region) {
+			*found = true;
+			return stream;
+		}
+		if (!stream->valid) {
+			oldest = stream;
+			break;
+		}
+		if (stream->stamp < oldest->stamp) {
+			oldest = stream;
+		}
+	}
+	*found = false;
+	oldest->valid = true;
+	oldest->region = region;
+	oldest->lastBlock = block;
+	oldest->stride = 0;
+	oldest->confidence = 0;
+	return oldest;
+}
+
+/*
+	Takes in a cache and the address of the block that was just accessed and
+	trains the prefetcher on it. NEXT_LINE_PREFETCH always prefetches the
+	blocks that follow it. STRIDE_PREFETCH prefetches along the stride of
+	its region once the same stride has been seen twice in a row.
+*/
+static void trainPrefetcher(cache_t* cache, uint32_t block) {
+	prefetcher_t* prefetcher = cache->prefetcher;
+	int64_t stride = cache->blockDataSize;
+	if (prefetcher->type == STRIDE_PREFETCH) {
+		bool found;
+		prefetchStream_t* stream = findStream(cache, block, &found);
+		stream->stamp = prefetcher->clock;
+		if (!found) {
+			return;
+		}
+		int64_t delta = (int64_t) block - stream->lastBlock;
+		if (delta == 0) {
+			return;
+		}
+		stream->lastBlock = block;
+		if (delta != stream->stride) {
+			stream->stride = delta;
+			stream->confidence = 0;
+			return;
+		}
+		if (stream->confidence < 3) {
+			stream->confidence++;
+		}
+		stride = delta;
+	}
+	for (uint32_t i = 0; i < prefetcher->degree; i++) {
+		int64_t address = (int64_t) block + stride * (int64_t) (prefetcher->distance + i);
+		if (address < MIN_ADDRESS || address > MAX_ADDRESS) {
+			break;
+		}
+		issuePrefetch(cache, (uint32_t) address);
+	}
+}
+
+/*
+	Takes in a cache and the prefetcher settings chosen in its options and
+	creates a prefetcher for it. Returns NULL if the type is NO_PREFETCH or
+	the degree or distance is 0.
+*/
+prefetcher_t* createPrefetcher(cache_t* cache, cacheOptions_t* options) {
+	if (options->prefetch == NO_PREFETCH || options->prefetchDegree == 0 || options->prefetchDistance == 0) {
+		return NULL;
+	}
+	prefetcher_t* prefetcher = malloc(sizeof(prefetcher_t));
+	if (prefetcher == NULL) {
+		allocationFailed();
+	}
+	prefetcher->marks = malloc(sizeof(uint8_t) * cache->geometry.numBlocks);
+	if (prefetcher->marks == NULL) {
+		free(prefetcher);
+		allocationFailed();
+	}
+	prefetcher->type = options->prefetch;
+	prefetcher->degree = options->prefetchDegree;
+	prefetcher->distance = options->prefetchDistance;
+	prefetcher->onHit = options->prefetchOnHit;
+	prefetcher->latency = options->prefetchLatency;
+	prefetcher->numBlocks = cache->geometry.numBlocks;
+	prefetcher->clock = 0;
+	prefetcher->issued = 0;
+	prefetcher->filled = 0;
+	prefetcher->useful = 0;
+	prefetcher->late = 0;
+	prefetcher->polluting = 0;
+	prefetcher->dropped = 0;
+	clearPrefetcher(prefetcher);
+	return prefetcher;
+}
+
+/*
+	Frees a prefetcher.
+*/
+void deletePrefetcher(prefetcher_t* prefetcher) {
+	if (prefetcher == NULL) {
+		return;
+	}
+	free(prefetcher->marks);
+	free(prefetcher);
+}
+
+/*
+	Takes in a prefetcher and forgets every mark, stream, and pending
+	prefetch without resetting the counts.
+*/
+void clearPrefetcher(prefetcher_t* prefetcher) {
+	if (prefetcher == NULL) {
+		return;
+	}
+	memset(prefetcher->marks, 0, prefetcher->numBlocks);
+	memset(prefetcher->streams, 0, sizeof(prefetcher->streams));
+	prefetcher->numPending = 0;
+}
+
+/*
+	Takes in a cache, the address of a demand access that has just been
+	completed, the block number it used, and whether it hit. Updates the
+	useful, late, and polluting counts, fills every pending prefetch that
+	is due, and trains the prefetcher, which may issue new prefetches. Does
+	nothing if the cache has no prefetcher.
+*/
+void runPrefetcher(cache_t* cache, uint32_t address, uint32_t blockNumber, bool hit) {
+	prefetcher_t* prefetcher = cache->prefetcher;
+	if (prefetcher == NULL) {
+		return;
+	}
+	uint32_t block = address & ~(cache->geometry.offsetMask);
+	prefetcher->clock++;
+
+	// the mark of the block used still describes the block that was there before a miss
+	if (hit && prefetcher->marks[blockNumber]) {
+		prefetcher->useful++;
+	} else if (!hit && prefetcher->marks[blockNumber]) {
+		prefetcher->polluting++;
+	}
+	prefetcher->marks[blockNumber] = 0;
+	if (!hit) {
+		for (uint32_t i = 0; i < prefetcher->numPending; i++) {
+			if (prefetcher->pendingAddresses[i] == block) {
+				prefetcher->late++;
+				removePending(prefetcher, i);
+				break;
+			}
+		}
+	}
+
+	// pending prefetches are due in the order they were issued
+	while (prefetcher->numPending > 0 && prefetcher->pendingDue[0] <= prefetcher->clock) {
+		uint32_t pending = prefetcher->pendingAddresses[0];
+		removePending(prefetcher, 0);
+		fillPrefetch(cache, pending);
+	}
+	if (!hit || prefetcher->onHit) {
+		trainPrefetcher(cache, block);
+	}
+}
@@ -0,0 +1,102 @@
+/* Summer 2017 */
+#ifndef PREFETCH_H
+#define PREFETCH_H
+
+/*
+	Number of address regions whose strides the STRIDE_PREFETCH prefetcher
+	tracks at once and the number of low address bits that are dropped to
+	find the region of an address.
+*/
+#define PREFETCH_STREAMS 16
+#define PREFETCH_REGION_BITS 12
+
+/*
+	Number of prefetches that can be waiting for their latency to pass.
+	Prefetches issued while the queue is full are dropped.
+*/
+#define PREFETCH_QUEUE 32
+
+/*
+	Struct used to hold the stride detected in one region of memory. The
+	last block is the address of the last block accessed in the region, the
+	stride is the distance in bytes from the block before it, and the
+	confidence counts how many times in a row the same stride was seen. The
+	stamp records when the region was last accessed so the oldest region is
+	replaced when the table is full.
+*/
+typedef struct prefetchStream
+{
+	bool valid;
+	uint32_t region;
+	uint32_t lastBlock;
+	int64_t stride;
+	uint8_t confidence;
+	uint64_t stamp;
+} prefetchStream_t;
+
+/*
+	Struct used to represent the prefetcher attached to a cache. Degree is
+	how many blocks are prefetched every time the prefetcher triggers and
+	distance is how many blocks or strides ahead of the access the first of
+	them is. If on hit is set the prefetcher is trained and triggered by
+	hits as well as misses. A prefetch is filled latency accesses after it
+	is issued and waits in the pending queue until then.
+
+	Marks holds one entry for each of the num blocks blocks of the cache
+	which is 1 while the block was filled by a prefetch and has not been
+	used yet. A prefetched block that is used is useful, one that is evicted
+	before it is used is polluting, and a miss on a block that is still
+	waiting in the queue is late. Issued counts the prefetches that were
+	issued, filled the ones that were placed in the cache, and dropped the
+	ones that were thrown away because the queue was full.
+*/
+typedef struct prefetcher
+{
+	enum prefetchType type;
+	uint32_t degree;
+	uint32_t distance;
+	bool onHit;
+	uint32_t latency;
+	uint32_t numBlocks;
+	uint8_t* marks;
+	prefetchStream_t streams[PREFETCH_STREAMS];
+	uint32_t numPending;
+	uint32_t pendingAddresses[PREFETCH_QUEUE];
+	uint64_t pendingDue[PREFETCH_QUEUE];
+	uint64_t clock;
+	uint64_t issued;
+	uint64_t filled;
+	uint64_t useful;
+	uint64_t late;
+	uint64_t polluting;
+	uint64_t dropped;
+} prefetcher_t;
+
+/*
+	Takes in a cache and the prefetcher settings chosen in its options and
+	creates a prefetcher for it. Returns NULL if the type is NO_PREFETCH or
+	the degree or distance is 0.
+*/
+prefetcher_t* createPrefetcher(cache_t* cache, cacheOptions_t* options);
+
+/*
+	Frees a prefetcher.
+*/
+void deletePrefetcher(prefetcher_t* prefetcher);
+
+/*
+	Takes in a prefetcher and forgets every mark, stream, and pending
+	prefetch without resetting the counts.
+*/
+void clearPrefetcher(prefetcher_t* prefetcher);
+
+/*
+	Takes in a cache, the address of a demand access that has just been
+	completed, the block number it used, and whether it hit. Updates the
+	useful, late, and polluting counts, fills every pending prefetch that
+	is due, and trains the prefetcher, which may issue new prefetches. Does
+	nothing if the cache has no prefetcher.
+*/
+void runPrefetcher(cache_t* cache, uint32_t address, uint32_t blockNumber, bool hit);
+
+#endif
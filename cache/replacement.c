@@ -0,0 +1,567 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "replacement.h"
+#include "bitfield.h"
+#include "getFromCache.h"
+#include "setInCache.h"
+
+/*
+	Takes in a cache and a set number and returns the first way in the set
+	that is not valid. Returns n if every way is valid.
+*/
+uint32_t firstInvalidWay(cache_t* cache, uint32_t set) {
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	for (uint32_t i = 0; i < cache->n; i++) {
+		if (!getValid(cache, zeroth + i)) {
+			return i;
+		}
+	}
+	return cache->n;
+}
+
+/*
+	Takes in a cache and a set number and returns the set metadata of the
+	replacement policy for that set.
+*/
+uint64_t getSetState(cache_t* cache, uint32_t set) {
+	uint8_t setBits = cache->geometry.setBits;
+	return readBits(cache->setState, (uint64_t) set * setBits, setBits);
+}
+
+/*
+	Takes in a cache, a set number, and a value and sets the set metadata of
+	the replacement policy for that set to the value.
+*/
+void setSetState(cache_t* cache, uint32_t set, uint64_t value) {
+	uint8_t setBits = cache->geometry.setBits;
+	writeBits(cache->setState, (uint64_t) set * setBits, setBits, value);
+}
+
+/*
+	Takes in a cache and returns the next number from its seeded pseudo
+	random number generator.
+*/
+uint64_t nextRandom(cache_t* cache) {
+	// xorshift64* so every cache with the same seed makes the same choices
+	uint64_t x = cache->randomState;
+	x ^= x >> 12;
+	x ^= x << 25;
+	x ^= x >> 27;
+	cache->randomState = x;
+	return x * UINT64_C(2685821657736338717);
+}
+
+/*
+	Takes in a cache and a block number and makes the block the most recently
+	used block of its set. Every block that was used more recently than it
+	moves back by one. Used by the policies that keep an LRU stack.
+*/
+void promoteBlock(cache_t* cache, uint32_t blockNumber) {
+	uint32_t zeroth = blockNumber & ~(cache->n - 1);
+	long oldLRU = getLRU(cache, blockNumber);
+	for (uint32_t i = 0; i < cache->n; i++) {
+		long currLRU = getLRU(cache, zeroth + i);
+		if (zeroth + i != blockNumber && currLRU < oldLRU) {
+			setLRU(cache, zeroth + i, currLRU + 1);
+		}
+	}
+	setLRU(cache, blockNumber, 0);
+}
+
+/*
+	Takes in a cache and a block number that was just invalidated and makes
+	it the least recently used block of its set. Every valid block that was
+	used less recently than it moves up by one. Used by the policies that
+	keep an LRU stack.
+*/
+void demoteBlock(cache_t* cache, uint32_t blockNumber) {
+	uint32_t zeroth = blockNumber & ~(cache->n - 1);
+	long oldLRU = getLRU(cache, blockNumber);
+	for (uint32_t i = 0; i < cache->n; i++) {
+		long currLRU = getLRU(cache, zeroth + i);
+		if (zeroth + i != blockNumber && getValid(cache, zeroth + i) && currLRU > oldLRU) {
+			setLRU(cache, zeroth + i, currLRU - 1);
+		}
+	}
+	setLRU(cache, blockNumber, cache->n - 1);
+}
+
+/*
+	Takes in a cache, a block number, and a position in the LRU stack and
+	moves the block to that position. Every block between the position and
+	the old position of the block moves back by one.
+*/
+static void insertBlock(cache_t* cache, uint32_t blockNumber, long position) {
+	uint32_t zeroth = blockNumber & ~(cache->n - 1);
+	long oldLRU = getLRU(cache, blockNumber);
+	for (uint32_t i = 0; i < cache->n; i++) {
+		long currLRU = getLRU(cache, zeroth + i);
+		if (zeroth + i != blockNumber && currLRU >= position && currLRU < oldLRU) {
+			setLRU(cache, zeroth + i, currLRU + 1);
+		}
+	}
+	setLRU(cache, blockNumber, position);
+}
+
+/*
+	LIP inserts a new block at the LRU position, which is the position below
+	every other valid block of the set. Blocks that are not valid share the
+	bottom of the stack so they are still filled before any valid block.
+*/
+static void lipFill(cache_t* cache, uint32_t blockNumber) {
+	uint32_t zeroth = blockNumber & ~(cache->n - 1);
+	long validBlocks = 0;
+	for (uint32_t i = 0; i < cache->n; i++) {
+		validBlocks += getValid(cache, zeroth + i);
+	}
+	insertBlock(cache, blockNumber, validBlocks > 0 ? validBlocks - 1 : 0);
+}
+
+/*
+	BIP inserts a new block at the MRU position once in 32 fills, chosen at
+	random, and at the LRU position otherwise.
+*/
+static void bipFill(cache_t* cache, uint32_t blockNumber) {
+	if ((nextRandom(cache) & 31) == 0) {
+		promoteBlock(cache, blockNumber);
+	} else {
+		lipFill(cache, blockNumber);
+	}
+}
+
+/*
+	DIP duels LRU, the first policy, against BIP, the second.
+*/
+static void dipFill(cache_t* cache, uint32_t blockNumber) {
+	if (duelingFill(cache, blockNumber) == 1) {
+		promoteBlock(cache, blockNumber);
+	} else {
+		bipFill(cache, blockNumber);
+	}
+}
+
+/*
+	Returns the number of bits needed to hold a position in an LRU stack,
+	which is log2 of the number of ways.
+*/
+static uint8_t stackBits(cache_t* cache) {
+	return log_2(cache->n);
+}
+
+/*
+	Used by the policies that keep no metadata of one kind.
+*/
+static uint8_t noBits(cache_t* cache) {
+	(void) cache;
+	return 0;
+}
+
+/*
+	Every block of an LRU stack starts at the bottom of the stack.
+*/
+static uint64_t stackResetValue(cache_t* cache) {
+	return cache->n - 1;
+}
+
+/*
+	Used by the policies that keep no block metadata.
+*/
+static uint64_t zeroResetValue(cache_t* cache) {
+	(void) cache;
+	return 0;
+}
+
+/*
+	Used by the policies that do nothing for an event.
+*/
+static void ignoreBlock(cache_t* cache, uint32_t blockNumber) {
+	(void) cache;
+	(void) blockNumber;
+}
+
+/*
+	Returns the way at the bottom of the LRU stack of a set. If several ways
+	share the bottom the earliest one is returned.
+*/
+static uint32_t bottomOfStack(cache_t* cache, uint32_t set) {
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	uint32_t victim = 0;
+	long maxLRU = getLRU(cache, zeroth);
+	for (uint32_t i = 1; i < cache->n; i++) {
+		long currLRU = getLRU(cache, zeroth + i);
+		if (currLRU > maxLRU) {
+			victim = i;
+			maxLRU = currLRU;
+		}
+	}
+	return victim;
+}
+
+/*
+	Returns the first way that is not valid or, if every way is valid, the
+	way at the top of the LRU stack of a set.
+*/
+static uint32_t topOfStack(cache_t* cache, uint32_t set) {
+	uint32_t victim = firstInvalidWay(cache, set);
+	if (victim < cache->n) {
+		return victim;
+	}
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	long minLRU = getLRU(cache, zeroth);
+	victim = 0;
+	for (uint32_t i = 1; i < cache->n; i++) {
+		long currLRU = getLRU(cache, zeroth + i);
+		if (currLRU < minLRU) {
+			victim = i;
+			minLRU = currLRU;
+		}
+	}
+	return victim;
+}
+
+/*
+	Returns the first way that is not valid or, if every way is valid, a
+	random way of a set.
+*/
+static uint32_t randomWay(cache_t* cache, uint32_t set) {
+	uint32_t victim = firstInvalidWay(cache, set);
+	if (victim < cache->n) {
+		return victim;
+	}
+	return (uint32_t) (nextRandom(cache) & (cache->n - 1));
+}
+
+/*
+	A PLRU tree has one bit for every inner node of a complete binary tree
+	whose leaves are the ways of the set. The nodes are numbered from 1 at
+	the root with the children of node k at 2k and 2k + 1, and node k is
+	stored in bit k - 1 of the set metadata. A bit of 0 means the pseudo
+	least recently used way is on the left and a bit of 1 means it is on
+	the right.
+*/
+static uint8_t treeBits(cache_t* cache) {
+	return (uint8_t) (cache->n - 1);
+}
+
+/*
+	Follows the bits of the tree of a set from the root to a leaf and
+	returns that way.
+*/
+static uint32_t treeVictim(cache_t* cache, uint32_t set) {
+	uint64_t tree = getSetState(cache, set);
+	uint32_t node = 1;
+	while (node < cache->n) {
+		node = (node << 1) | (uint32_t) ((tree >> (node - 1)) & 1);
+	}
+	return node - cache->n;
+}
+
+/*
+	Walks from the leaf of a block to the root of its tree and points every
+	node on the way away from the block, or towards it if toward is set.
+*/
+static void treePoint(cache_t* cache, uint32_t blockNumber, uint8_t toward) {
+	uint32_t set = blockNumber >> cache->geometry.waysBits;
+	uint64_t tree = getSetState(cache, set);
+	uint32_t node = (blockNumber & (cache->n - 1)) + cache->n;
+	while (node > 1) {
+		uint64_t bit = (uint64_t) 1 << ((node >> 1) - 1);
+		// a leaf on the right side points its parent left unless toward is set
+		if ((node & 1) ^ toward) {
+			tree &= ~bit;
+		} else {
+			tree |= bit;
+		}
+		node >>= 1;
+	}
+	setSetState(cache, set, tree);
+}
+
+/*
+	A hit or a fill makes the block the most recently used of its tree.
+*/
+static void treeTouch(cache_t* cache, uint32_t blockNumber) {
+	treePoint(cache, blockNumber, 0);
+}
+
+/*
+	An invalidated block becomes the next victim of its tree.
+*/
+static void treeInvalidate(cache_t* cache, uint32_t blockNumber) {
+	treePoint(cache, blockNumber, 1);
+}
+
+/*
+	Takes in a cache and a set number and returns which policy the set uses
+	under set dueling. Returns 1 if the set is a leader set of the first
+	policy, 2 if it is a leader set of the second policy, and 0 if it is a
+	follower set which uses whichever policy psel currently selects. There
+	are at most 32 leader sets of each policy and at least half of the sets
+	are followers, so the cache must have MIN_DUELING_SETS sets or more.
+*/
+int duelingSet(cache_t* cache, uint32_t set) {
+	// 32 leader sets of each policy, or one of each in every group of MIN_DUELING_SETS sets
+	uint32_t period = cache->geometry.numSets >> 5;
+	if (period < MIN_DUELING_SETS) {
+		period = MIN_DUELING_SETS;
+	}
+	uint32_t position = set & (period - 1);
+	if (position == 0) {
+		return 1;
+	} else if (position == 1) {
+		return 2;
+	}
+	return 0;
+}
+
+/*
+	Takes in a cache and the block number of a block that was just filled
+	after a miss and updates psel if the block is in a leader set. A miss
+	in a leader set of the first policy counts against the first policy and
+	a miss in a leader set of the second policy counts against the second.
+	Returns 1 if the block should be filled the way the first policy fills
+	it and 2 if it should be filled the way the second policy does.
+*/
+int duelingFill(cache_t* cache, uint32_t blockNumber) {
+	uint32_t pselMax = (1 << PSEL_BITS) - 1;
+	int leader = duelingSet(cache, blockNumber >> cache->geometry.waysBits);
+	if (leader == 1 && cache->psel < pselMax) {
+		cache->psel++;
+	} else if (leader == 2 && cache->psel > 0) {
+		cache->psel--;
+	}
+	if (leader != 0) {
+		return leader;
+	}
+	return cache->psel < (1 << (PSEL_BITS - 1)) ? 1 : 2;
+}
+
+/*
+	The RRIP policies keep a re-reference prediction value in the LRU field
+	of every block. 0 means the block is expected to be used again soon and
+	the maximum value, the distant value, means it is not expected to be used
+	again before it is evicted.
+*/
+static uint8_t rripBlockBits(cache_t* cache) {
+	return cache->rripBits;
+}
+
+static uint64_t rripDistant(cache_t* cache) {
+	return ((uint64_t) 1 << cache->rripBits) - 1;
+}
+
+/*
+	Returns the first way that is not valid or, if every way is valid, the
+	first way with the distant value. If no way has the distant value every
+	block in the set is aged by the amount the oldest block needs to reach
+	it, the same as aging them one step at a time until one of them does.
+*/
+static uint32_t rripVictim(cache_t* cache, uint32_t set) {
+	uint32_t victim = firstInvalidWay(cache, set);
+	if (victim < cache->n) {
+		return victim;
+	}
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	long distant = (long) rripDistant(cache);
+	long maxRRPV = getLRU(cache, zeroth);
+	victim = 0;
+	for (uint32_t i = 1; i < cache->n && maxRRPV < distant; i++) {
+		long currRRPV = getLRU(cache, zeroth + i);
+		if (currRRPV > maxRRPV) {
+			victim = i;
+			maxRRPV = currRRPV;
+		}
+	}
+	if (maxRRPV < distant) {
+		for (uint32_t i = 0; i < cache->n; i++) {
+			setLRU(cache, zeroth + i, getLRU(cache, zeroth + i) + (distant - maxRRPV));
+		}
+	}
+	return victim;
+}
+
+/*
+	A hit predicts the block will be used again soon.
+*/
+static void rripHit(cache_t* cache, uint32_t blockNumber) {
+	setLRU(cache, blockNumber, 0);
+}
+
+/*
+	An invalidated block is given the distant value.
+*/
+static void rripInvalidate(cache_t* cache, uint32_t blockNumber) {
+	setLRU(cache, blockNumber, rripDistant(cache));
+}
+
+/*
+	SRRIP fills a block with a long re-reference interval, one less than the
+	distant value.
+*/
+static void srripFill(cache_t* cache, uint32_t blockNumber) {
+	setLRU(cache, blockNumber, rripDistant(cache) - 1);
+}
+
+/*
+	BRRIP fills a block with the distant value except for one fill in 32,
+	chosen at random, which gets the long interval SRRIP uses.
+*/
+static void brripFill(cache_t* cache, uint32_t blockNumber) {
+	if ((nextRandom(cache) & 31) == 0) {
+		setLRU(cache, blockNumber, rripDistant(cache) - 1);
+	} else {
+		setLRU(cache, blockNumber, rripDistant(cache));
+	}
+}
+
+/*
+	DRRIP duels SRRIP, the first policy, against BRRIP, the second.
+*/
+static void drripFill(cache_t* cache, uint32_t blockNumber) {
+	if (duelingFill(cache, blockNumber) == 1) {
+		srripFill(cache, blockNumber);
+	} else {
+		brripFill(cache, blockNumber);
+	}
+}
+
+/*
+	STAMP_LRU gives every block the value of the clock of its set when it
+	was last used and keeps the clock in the set metadata. A block that has
+	never been used or was invalidated has a stamp of 0. The order of the
+	stamps is the reverse of the order of the LRU stack and blocks that
+	share the bottom of the stack share a stamp of 0, so the earliest way
+	with the smallest stamp is the block LRU would evict.
+*/
+static uint8_t stampBits(cache_t* cache) {
+	(void) cache;
+	return 32;
+}
+
+static uint8_t clockBits(cache_t* cache) {
+	return cache->n > 1 ? 32 : 0;
+}
+
+/*
+	Returns the earliest way with the smallest stamp in a set.
+*/
+static uint32_t oldestStamp(cache_t* cache, uint32_t set) {
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	uint32_t victim = 0;
+	long minStamp = getLRU(cache, zeroth);
+	for (uint32_t i = 1; i < cache->n && minStamp > 0; i++) {
+		long currStamp = getLRU(cache, zeroth + i);
+		if (currStamp < minStamp) {
+			victim = i;
+			minStamp = currStamp;
+		}
+	}
+	return victim;
+}
+
+/*
+	Renumbers the stamps of a set from 1 in the same order when its clock
+	is about to wrap around, and restarts the clock after the newest stamp.
+*/
+static void renumberStamps(cache_t* cache, uint32_t set) {
+	uint32_t zeroth = set << cache->geometry.waysBits;
+	uint64_t clock = 0;
+	long floor = 0;
+	for (uint32_t assigned = 0; assigned < cache->n; assigned++) {
+		// find the next smallest stamp above the last one renumbered
+		long next = -1;
+		uint32_t way = 0;
+		for (uint32_t i = 0; i < cache->n; i++) {
+			long currStamp = getLRU(cache, zeroth + i);
+			if (currStamp > floor && (next == -1 || currStamp < next)) {
+				next = currStamp;
+				way = i;
+			}
+		}
+		if (next == -1) {
+			break;
+		}
+		floor = next;
+		setLRU(cache, zeroth + way, ++clock);
+	}
+	setSetState(cache, set, clock);
+}
+
+/*
+	A hit or a fill gives the block the next value of the clock of its set.
+*/
+static void stampBlock(cache_t* cache, uint32_t blockNumber) {
+	uint32_t set = blockNumber >> cache->geometry.waysBits;
+	uint64_t clock = getSetState(cache, set);
+	if (clock == UINT32_MAX) {
+		renumberStamps(cache, set);
+		clock = getSetState(cache, set);
+	}
+	setLRU(cache, blockNumber, ++clock);
+	setSetState(cache, set, clock);
+}
+
+/*
+	An invalidated block goes back to the bottom of the stack.
+*/
+static void clearStamp(cache_t* cache, uint32_t blockNumber) {
+	setLRU(cache, blockNumber, 0);
+}
+
+/*
+	LRU keeps every set as a stack ordered by last use. FIFO keeps the same
+	stack ordered by when each block was filled by not moving a block on a
+	hit. MRU keeps the LRU stack but evicts from the top. PLRU keeps only
+	the tree of each set. The RRIP policies only differ in how they fill and
+	so do LRU and the insertion policies. STAMP_LRU keeps timestamps in
+	place of the LRU stack.
+*/
+static const replacementPolicy_t lruPolicy = {stackBits, noBits, stackResetValue, bottomOfStack, promoteBlock, promoteBlock, demoteBlock};
+static const replacementPolicy_t fifoPolicy = {stackBits, noBits, stackResetValue, bottomOfStack, ignoreBlock, promoteBlock, demoteBlock};
+static const replacementPolicy_t randomPolicy = {noBits, noBits, zeroResetValue, randomWay, ignoreBlock, ignoreBlock, ignoreBlock};
+static const replacementPolicy_t mruPolicy = {stackBits, noBits, stackResetValue, topOfStack, promoteBlock, promoteBlock, demoteBlock};
+static const replacementPolicy_t plruPolicy = {noBits, treeBits, zeroResetValue, treeVictim, treeTouch, treeTouch, treeInvalidate};
+static const replacementPolicy_t srripPolicy = {rripBlockBits, noBits, rripDistant, rripVictim, rripHit, srripFill, rripInvalidate};
+static const replacementPolicy_t brripPolicy = {rripBlockBits, noBits, rripDistant, rripVictim, rripHit, brripFill, rripInvalidate};
+static const replacementPolicy_t drripPolicy = {rripBlockBits, noBits, rripDistant, rripVictim, rripHit, drripFill, rripInvalidate};
+static const replacementPolicy_t lipPolicy = {stackBits, noBits, stackResetValue, bottomOfStack, promoteBlock, lipFill, demoteBlock};
+static const replacementPolicy_t bipPolicy = {stackBits, noBits, stackResetValue, bottomOfStack, promoteBlock, bipFill, demoteBlock};
+static const replacementPolicy_t dipPolicy = {stackBits, noBits, stackResetValue, bottomOfStack, promoteBlock, dipFill, demoteBlock};
+static const replacementPolicy_t stampLRUPolicy = {stampBits, clockBits, zeroResetValue, oldestStamp, stampBlock, stampBlock, clearStamp};
+
+/*
+	Takes in one of the stock replacement policies and returns the policy
+	struct that implements it.
+*/
+const replacementPolicy_t* getReplacementPolicy(enum replacement replacement) {
+	switch (replacement) {
+		case FIFO_REPLACEMENT:
+			return &fifoPolicy;
+		case RANDOM_REPLACEMENT:
+			return &randomPolicy;
+		case MRU_REPLACEMENT:
+			return &mruPolicy;
+		case PLRU_REPLACEMENT:
+			return &plruPolicy;
+		case SRRIP_REPLACEMENT:
+			return &srripPolicy;
+		case BRRIP_REPLACEMENT:
+			return &brripPolicy;
+		case DRRIP_REPLACEMENT:
+			return &drripPolicy;
+		case LIP_REPLACEMENT:
+			return &lipPolicy;
+		case BIP_REPLACEMENT:
+			return &bipPolicy;
+		case DIP_REPLACEMENT:
+			return &dipPolicy;
+		case STAMP_LRU_REPLACEMENT:
+			return &stampLRUPolicy;
+		default:
+			return &lruPolicy;
+	}
+}
@@ -0,0 +1,100 @@
+/* Summer 2017 */
+#ifndef REPLACEMENT_H
+#define REPLACEMENT_H
+
+/*
+	Struct used to represent a replacement policy. Every hook takes in the
+	cache the policy belongs to.
+
+	Block bits and set bits return how many bits of metadata the policy keeps
+	for every block and for every set. The block metadata is stored in the
+	LRU field of each block and read and written with getLRU and setLRU. The
+	set metadata is read and written with getSetState and setSetState.
+
+	Reset value returns the block metadata every block starts with after the
+	cache is cleared. The set metadata is cleared to 0.
+
+	Victim takes in a set number and returns the way of the block in that
+	set that should be evicted on a miss.
+
+	On hit, on fill, and on invalidate take in a block number and are called
+	after the block is read or written on a hit, after a new block is placed
+	in it, and after it is invalidated by another cache.
+*/
+typedef struct replacementPolicy
+{
+	uint8_t (*blockBits)(cache_t* cache);
+	uint8_t (*setBits)(cache_t* cache);
+	uint64_t (*resetValue)(cache_t* cache);
+	uint32_t (*victim)(cache_t* cache, uint32_t set);
+	void (*onHit)(cache_t* cache, uint32_t blockNumber);
+	void (*onFill)(cache_t* cache, uint32_t blockNumber);
+	void (*onInvalidate)(cache_t* cache, uint32_t blockNumber);
+} replacementPolicy_t;
+
+/*
+	Takes in one of the stock replacement policies and returns the policy
+	struct that implements it.
+*/
+const replacementPolicy_t* getReplacementPolicy(enum replacement replacement);
+
+/*
+	Takes in a cache and a set number and returns the first way in the set
+	that is not valid. Returns n if every way is valid.
+*/
+uint32_t firstInvalidWay(cache_t* cache, uint32_t set);
+
+/*
+	Takes in a cache and a set number and returns the set metadata of the
+	replacement policy for that set.
+*/
+uint64_t getSetState(cache_t* cache, uint32_t set);
+
+/*
+	Takes in a cache, a set number, and a value and sets the set metadata of
+	the replacement policy for that set to the value.
+*/
+void setSetState(cache_t* cache, uint32_t set, uint64_t value);
+
+/*
+	Takes in a cache and returns the next number from its seeded pseudo
+	random number generator.
+*/
+uint64_t nextRandom(cache_t* cache);
+
+/*
+	Takes in a cache and a set number and returns which policy the set uses
+	under set dueling. Returns 1 if the set is a leader set of the first
+	policy, 2 if it is a leader set of the second policy, and 0 if it is a
+	follower set which uses whichever policy psel currently selects. There
+	are at most 32 leader sets of each policy and at least half of the sets
+	are followers, so the cache must have MIN_DUELING_SETS sets or more.
+*/
+int duelingSet(cache_t* cache, uint32_t set);
+
+/*
+	Takes in a cache and the block number of a block that was just filled
+	after a miss and updates psel if the block is in a leader set. A miss
+	in a leader set of the first policy counts against the first policy and
+	a miss in a leader set of the second policy counts against the second.
+	Returns 1 if the block should be filled the way the first policy fills
+	it and 2 if it should be filled the way the second policy does.
+*/
+int duelingFill(cache_t* cache, uint32_t blockNumber);
+
+/*
+	Takes in a cache and a block number and makes the block the most recently
+	used block of its set. Every block that was used more recently than it
+	moves back by one. Used by the policies that keep an LRU stack.
+*/
+void promoteBlock(cache_t* cache, uint32_t blockNumber);
+
+/*
+	Takes in a cache and a block number that was just invalidated and makes
+	it the least recently used block of its set. Every valid block that was
+	used less recently than it moves up by one. Used by the policies that
+	keep an LRU stack.
+*/
+void demoteBlock(cache_t* cache, uint32_t blockNumber);
+
+#endif
@@ -0,0 +1,132 @@
+/* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "sector.h"
+#include "getFromCache.h"
+#include "setInCache.h"
+#include "cacheWrite.h"
+#include "mem.h"
+
+/*
+	Takes in a cache and a range of size bytes starting at offset inside of
+	a block and returns a mask with the bit of every sector the range
+	touches turned on.
+*/
+static uint64_t sectorRange(cache_t* cache, uint32_t offset, uint32_t size) {
+	uint8_t shift = cache->geometry.sectorShift;
+	uint32_t first = offset >> shift;
+	uint32_t last = (offset + size - 1) >> shift;
+	uint64_t upper = last == 63 ? UINT64_MAX : (UINT64_C(1) << (last + 1)) - 1;
+	return upper & ~((UINT64_C(1) << first) - 1);
+}
+
+/*
+	Takes in a sectored cache, the block number of a block that is being
+	replaced, and the address of the block that will be placed in it. Evicts
+	the old block and gives the block the tag of the address with every
+	sector invalid. The block is valid, clean, and not shared afterwards.
+	The replacement policy is not told about the fill.
+*/
+void allocateSectoredBlock(cache_t* cache, uint32_t blockNumber, uint32_t address) {
+	evict(cache, blockNumber);
+	setTag(cache, getTag(cache, address), blockNumber);
+	setValid(cache, blockNumber, 1);
+	setDirty(cache, blockNumber, 0);
+	setShared(cache, blockNumber, 0);
+	cache->sectorValid[blockNumber] = 0;
+	cache->sectorDirty[blockNumber] = 0;
+}
+
+/*
+	Takes in a sectored cache, the block number of a block that holds the
+	tag of the address, and a range of size bytes starting at address, and
+	reads every sector of the range that is not valid from physical memory.
+	If write is set the range is about to be written and the sectors it
+	covers completely are not read. Returns 1 if every sector of the range
+	was already valid and 0 otherwise. Does nothing and returns 1 if the
+	cache is not sectored.
+*/
+int fillSectors(cache_t* cache, uint32_t blockNumber, uint32_t address, uint32_t size, bool write) {
+	if (cache->sectorSize == 0) {
+		return 1;
+	}
+	uint8_t shift = cache->geometry.sectorShift;
+	uint32_t offset = getOffset(cache, address);
+	uint32_t block = address - offset;
+	uint64_t range = sectorRange(cache, offset, size);
+	uint64_t needed = range & ~(cache->sectorValid[blockNumber]);
+	if (needed == 0) {
+		return 1;
+	}
+
+	// only a sector the store leaves partly unwritten has to be read first
+	if (write) {
+		uint32_t start = (offset + cache->sectorSize - 1) >> shift;
+		uint32_t end = (offset + size) >> shift;
+		if (end > start) {
+			needed &= ~sectorRange(cache, start << shift, (end - start) << shift);
+		}
+	}
+
+	// adjacent sectors are read from memory together
+	uint8_t* data = takeBlockBuffer(cache);
+	uint64_t remaining = needed;
+	while (remaining != 0) {
+		uint32_t first = __builtin_ctzll(remaining);
+		uint32_t last = first;
+		while (last + 1 < cache->geometry.numSectors && (remaining >> (last + 1)) & 1) {
+			last++;
+		}
+		uint32_t length = (last - first + 1) << shift;
+		readBytesFromMem(cache, block + (first << shift), data, length);
+		setData(cache, data, blockNumber, length, first << shift);
+		remaining &= ~sectorRange(cache, first << shift, length);
+	}
+	releaseBlockBuffer(cache);
+	cache->sectorValid[blockNumber] |= needed;
+	return 0;
+}
+
+/*
+	Takes in a cache, a block number, and a range of size bytes starting at
+	offset that was just written to the block and marks every sector of the
+	range valid, and dirty as well if dirty is set. Does nothing if the cache
+	is not sectored.
+*/
+void markSectors(cache_t* cache, uint32_t blockNumber, uint32_t offset, uint32_t size, uint8_t dirty) {
+	if (cache->sectorSize == 0) {
+		return;
+	}
+	uint64_t range = sectorRange(cache, offset, size);
+	cache->sectorValid[blockNumber] |= range;
+	if (dirty) {
+		cache->sectorDirty[blockNumber] |= range;
+	}
+}
+
+/*
+	Takes in a sectored cache, a block number, and the address of the block
+	and writes every dirty sector of the block back to physical memory.
+	Adjacent dirty sectors are written together. Like evict this does not
+	change any of the bits in the cache.
+*/
+void writeBackSectors(cache_t* cache, uint32_t blockNumber, uint32_t address) {
+	uint8_t shift = cache->geometry.sectorShift;
+	uint8_t* data = takeBlockBuffer(cache);
+	uint64_t remaining = cache->sectorDirty[blockNumber];
+	while (remaining != 0) {
+		uint32_t first = __builtin_ctzll(remaining);
+		uint32_t last = first;
+		while (last + 1 < cache->geometry.numSectors && (remaining >> (last + 1)) & 1) {
+			last++;
+		}
+		uint32_t length = (last - first + 1) << shift;
+		getDataInto(cache, first << shift, blockNumber, length, data);
+		writeBytesToMem(cache, address + (first << shift), data, length);
+		remaining &= ~sectorRange(cache, first << shift, length);
+	}
+	releaseBlockBuffer(cache);
+}
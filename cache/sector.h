@@ -0,0 +1,47 @@
+/* Summer 2017 */
+#ifndef SECTOR_H
+#define SECTOR_H
+
+/*
+	Maximum number of sectors in a block, so the valid and dirty bits of
+	every sector of a block fit in one word.
+*/
+#define MAX_SECTORS 64
+
+/*
+	Takes in a sectored cache, the block number of a block that is being
+	replaced, and the address of the block that will be placed in it. Evicts
+	the old block and gives the block the tag of the address with every
+	sector invalid. The block is valid, clean, and not shared afterwards.
+	The replacement policy is not told about the fill.
+*/
+void allocateSectoredBlock(cache_t* cache, uint32_t blockNumber, uint32_t address);
+
+/*
+	Takes in a sectored cache, the block number of a block that holds the
+	tag of the address, and a range of size bytes starting at address, and
+	reads every sector of the range that is not valid from physical memory.
+	If write is set the range is about to be written and the sectors it
+	covers completely are not read. Returns 1 if every sector of the range
+	was already valid and 0 otherwise. Does nothing and returns 1 if the
+	cache is not sectored.
+*/
+int fillSectors(cache_t* cache, uint32_t blockNumber, uint32_t address, uint32_t size, bool write);
+
+/*
+	Takes in a cache, a block number, and a range of size bytes starting at
+	offset that was just written to the block and marks every sector of the
+	range valid, and dirty as well if dirty is set. Does nothing if the cache
+	is not sectored.
+*/
+void markSectors(cache_t* cache, uint32_t blockNumber, uint32_t offset, uint32_t size, uint8_t dirty);
+
+/*
+	Takes in a sectored cache, a block number, and the address of the block
+	and writes every dirty sector of the block back to physical memory.
+	Adjacent dirty sectors are written together. Like evict this does not
+	change any of the bits in the cache.
+*/
+void writeBackSectors(cache_t* cache, uint32_t blockNumber, uint32_t address);
+
+#endif
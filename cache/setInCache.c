@@ -1,11 +1,18 @@
 /* Summer 2017 */
 #include <math.h>
+#include <string.h>
 #include <stdbool.h>
 #include <stdint.h>
 #include "utils.h"
 #include "setInCache.h"
+#include "bitfield.h"
+#include "bitcopy.h"
 #include "getFromCache.h"
 #include "cacheWrite.h"
+#include "mem.h"
+#include "replacement.h"
+#include "victimCache.h"
+#include "prefetch.h"
 
 /*
 	Takes in a cache and block number and value (either 1 or 0) and sets
@@ -13,6 +20,14 @@
 */
 void setValid(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 	/* Your Code Here. */
+	if (cache->layout == ALIGNED) {
+		if (value) {
+			cache->flags[blockNumber] |= VALID_FLAG;
+		} else {
+			cache->flags[blockNumber] &= ~VALID_FLAG;
+		}
+		return;
+	}
 	uint64_t validLocation = getValidLocation(cache, blockNumber);
 	setBit(cache, validLocation, value);
 }
@@ -23,6 +38,14 @@ void setValid(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 */
 void setDirty(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 	/* Your Code Here. */
+	if (cache->layout == ALIGNED) {
+		if (value) {
+			cache->flags[blockNumber] |= DIRTY_FLAG;
+		} else {
+			cache->flags[blockNumber] &= ~DIRTY_FLAG;
+		}
+		return;
+	}
 	uint64_t dirtyLocation = getDirtyLocation(cache, blockNumber);
 	setBit(cache, dirtyLocation, value);
 }
@@ -33,6 +56,14 @@ void setDirty(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 */
 void setShared(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 	/* Your Code Here. */
+	if (cache->layout == ALIGNED) {
+		if (value) {
+			cache->flags[blockNumber] |= SHARED_FLAG;
+		} else {
+			cache->flags[blockNumber] &= ~SHARED_FLAG;
+		}
+		return;
+	}
 	uint64_t sharedLocation = getSharedLocation(cache, blockNumber);
 	setBit(cache, sharedLocation, value);
 }
@@ -42,21 +73,11 @@ void setShared(cache_t* cache, uint32_t blockNumber, uint8_t value) {
 	at that bit location in the cache to the value passed in.
 */
 void setBit(cache_t* cache, uint64_t location, uint8_t value) {
-	uint64_t byteNumber = location / 8;
-	uint8_t contentBits = cache->contents[byteNumber];
-	uint8_t bitNumber = location % 8;
-
-	uint8_t mask = 0;
-	int i = 0;
-	for (; i < bitNumber; i++) {
-		mask += (contentBits & (1 << (7 - i)));
-	}
-	mask += (value << (7 - i));
-	i++;
-	for (; i < 8; i++) {
-		mask += (contentBits & (1 << (7 - i)));
+	if (cache->layout == ALIGNED) {
+		setAlignedBit(cache, location, value);
+		return;
 	}
-	cache->contents[byteNumber] = mask;
+	writeBits(cache->contents, location, 1, value);
 }
 
 /*
@@ -65,13 +86,11 @@ void setBit(cache_t* cache, uint64_t location, uint8_t value) {
 */
 void setLRU(cache_t* cache, uint32_t blockNumber, long newLRU) {
 	/* Your Code Here. */
-	uint64_t lruLocation = getLRULocation(cache, blockNumber);
-	uint8_t numBits = numLRUBits(cache);
-
-	for (uint8_t i = 0; i < numBits; i++) {
-		uint8_t value = (newLRU >> i) & 1;
-		setBit(cache, lruLocation + numBits - 1 - i, value);
+	if (cache->layout == ALIGNED) {
+		cache->LRU[blockNumber] = (uint32_t) newLRU;
+		return;
 	}
+	writeBits(cache->contents, getLRULocation(cache, blockNumber), cache->geometry.lruBits, (uint64_t) newLRU);
 }
 
 /*
@@ -80,44 +99,17 @@ void setLRU(cache_t* cache, uint32_t blockNumber, long newLRU) {
 	at the offset specified.
 */
 void setData(cache_t* cache, uint8_t* data, uint32_t blockNumber, uint32_t length, uint32_t offset) {
-	uint8_t temp;
-	uint8_t mask;
-	uint32_t start;
-	uint64_t totalBits;
+	if (cache->layout == ALIGNED) {
+		memcpy(cache->data + ((uint64_t) blockNumber * cache->blockDataSize) + offset, data, length);
+		return;
+	}
 	uint64_t location = getDataLocation(cache, blockNumber, offset);
 	uint64_t byteLoc = location >> 3;
 	int shiftAmount = location & 7;
 	if (shiftAmount == 0) {
-		for (uint32_t i = 0; i < length; i++) {
-			cache->contents[byteLoc + i] = data[i];
-		}
+		memcpy(cache->contents + byteLoc, data, length);
 	} else {
-		start = 0;
-		mask = 0;
-		for (int j = 0; j < (8 - shiftAmount); j++) {
-			mask += (1 << j);
-		}
-		mask = ~mask;
-		totalBits = length << 3;
-		temp = data[start] >> (shiftAmount);
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] & mask;
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] | temp;
-		totalBits -= (8 - shiftAmount);
-		while (totalBits > 7) {
-			temp = data[start] << (8 - shiftAmount);
-			temp = temp | (data[start + 1] >> shiftAmount);
-			cache->contents[byteLoc + start + 1] = temp;
-			totalBits -= 8;
-			start += 1;
-		}
-		temp = data[start] << (8 - shiftAmount);
-		mask = 0;
-		for (int k = 0; k < shiftAmount; k++) {
-			mask += (1 << (7 - k));
-		}
-		mask = ~mask;
-		cache->contents[byteLoc + start + 1] = cache->contents[byteLoc + start + 1] & mask;
-		cache->contents[byteLoc + start + 1] = cache->contents[byteLoc + start + 1] | temp;
+		copyToBitOffset(cache->contents + byteLoc, data, shiftAmount, length);
 	}
 }
 
@@ -126,110 +118,130 @@ void setData(cache_t* cache, uint8_t* data, uint32_t blockNumber, uint32_t lengt
 	specified to be the value passed in.
 */
 void setTag(cache_t* cache, uint32_t tag, uint32_t blockNumber) {
-	uint8_t mask;
-	uint8_t temp;
-	uint64_t location = getTagLocation(cache, blockNumber);
-	uint64_t byteLoc = location >> 3;
-	uint8_t shiftAmount = location & 7;
-	uint8_t totalBits = getTagSize(cache);
-	int start = 0;
-	mask = 0;
-	if (totalBits + shiftAmount < 8) {
-		for (int i = shiftAmount; i < totalBits + shiftAmount; i++) {
-			mask += 1 << (7 - i);
-		}
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] & ~mask;
-		temp = (uint8_t) (tag << (8 - shiftAmount - totalBits));
-		temp = temp & mask;
-		cache->contents[byteLoc + start] = cache->contents[byteLoc] | temp;
+	if (cache->layout == ALIGNED) {
+		cache->tags[blockNumber] = tag;
 		return;
-	} else {
-		for (int i = 0; i < (8 - shiftAmount); i++) {
-			mask += (1 << i);
-		}
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] & ~mask;
-		temp = (uint8_t) (tag >> (shiftAmount + totalBits - 8));
-		temp = temp & mask;
-		cache->contents[byteLoc + start] = cache->contents[byteLoc] | temp;
-		totalBits -= (8 - shiftAmount);
-		start += 1;
-	}
-	while (totalBits > 7) {
-		temp = (uint8_t) (tag >> (totalBits - 8));
-		temp = temp & UINT8_MAX;
-		cache->contents[byteLoc + start] = temp;
-		start += 1;
-		totalBits -= 8;
-	}
-	if (totalBits != 0) {
-		mask = 0;
-		for (int j = 0; j < totalBits; j++) {
-			mask += (1 << (7 - j));
-		}
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] & ~mask;
-		temp = (uint8_t) (tag << (8 - totalBits));
-		temp = temp & mask;
-		cache->contents[byteLoc + start] = cache->contents[byteLoc + start] | temp;
 	}
+	writeBits(cache->contents, getTagLocation(cache, blockNumber), cache->geometry.tagBits, tag);
 }
 
 /*
 	Takes a newly initialized cache or a cache which has shifted programs and
-	sets all of the valid bits to 0. Also sets all LRU bits to the maximum value.
-	Effectively clears the cache.
+	sets all of the valid bits to 0. Effectively clears the cache. The dirty
+	and shared bits and the tags are cleared as well, every LRU is set to
+	the reset value of the replacement policy, which is its maximum with
+	LRU, and the set metadata of the policy is cleared. The victim cache is
+	emptied without writing anything back and the prefetcher forgets what it
+	has learned.
 */
 void clearCache(cache_t* cache) {
 	/* Your Code Here. */
-	uint32_t blockNum = (cache->totalDataSize / cache->blockDataSize);
-	for (int i = 0; i < blockNum; i++) {
-		setValid(cache, i, 0);
-		setTag(cache, 0, i);
+	geometry_t* geometry = &(cache->geometry);
+	uint32_t blockNum = geometry->numBlocks;
+	if (cache->layout == ALIGNED) {
+		memset(cache->flags, 0, blockNum);
+		memset(cache->tags, 0, sizeof(uint32_t) * blockNum);
+		initializeLRU(cache);
+	} else {
+		// the flags, LRU, and tag of a block are rewritten with whole word stores
+		uint64_t lru = cache->policy->resetValue(cache);
+		uint64_t location = geometry->garbageBits;
+		for (uint32_t i = 0; i < blockNum; i++, location += geometry->blockBits) {
+			if (geometry->dataStart <= 64) {
+				writeBits(cache->contents, location, (uint8_t) geometry->dataStart, lru << geometry->tagBits);
+			} else {
+				writeBits(cache->contents, location, (uint8_t) geometry->tagStart, lru);
+				writeBits(cache->contents, location + geometry->tagStart, geometry->tagBits, 0);
+			}
+		}
+		memset(cache->setState, 0, ((uint64_t) geometry->numSets * geometry->setBits + 7) >> 3);
+	}
+	clearVictimCache(cache->victim);
+	clearPrefetcher(cache->prefetcher);
+	if (cache->sectorSize != 0) {
+		memset(cache->sectorValid, 0, sizeof(uint64_t) * blockNum);
+		memset(cache->sectorDirty, 0, sizeof(uint64_t) * blockNum);
 	}
-	initializeLRU(cache);
 	cache->hit = 0;
 	cache->access = 0;
+	cache->victimHit = 0;
+	cache->victimSwap = 0;
+	cache->victimWriteBack = 0;
+	cache->backInvalidations = 0;
 }
 
 /*
 	Takes in a cache that is switching between programs and clears it, writing
-	an dirty values to memory.
+	an dirty values to memory. The dirty blocks are written in address order
+	in one pass by writeBackAll and physical memory is flushed afterwards, so
+	none of them are left in a write back buffer.
 */
 void contextSwitch(cache_t* cache) {
-	uint32_t numBlocks = getNumSets(cache) << (log_2(cache->n));
-	for (int i = 0; i < numBlocks; i++) {
-		evict(cache, i);
-	}
+	writeBackAll(cache);
+	flushMem(cache);
 	clearCache(cache);
 }
 
 /*
 	Takes in a newly created cache or cleared cache and initialises all LRU
-	values to be maximal.
+	values to be maximal. With a replacement policy other than LRU the LRU
+	values are set to the reset value of the policy and the set metadata is
+	cleared.
 */
 void initializeLRU(cache_t* cache) {
-	for (int i = 0; i < getNumSets(cache) << log_2(cache->n); i++) {
-		setLRU(cache, i, cache->n - 1);
+	uint64_t lru = cache->policy->resetValue(cache);
+	for (int i = 0; i < cache->geometry.numBlocks; i++) {
+		setLRU(cache, i, lru);
 	}
+	memset(cache->setState, 0, ((uint64_t) cache->geometry.numSets * cache->geometry.setBits + 7) >> 3);
 }
 
 /*
-	Takes in a cache, the tag, and index of the accessed data
-	along with the original LRU way and updates all of the LRU's in the
-	cache that need to be updated.
+	Takes in a cache and the block number of a block that was just read or
+	written and updates the replacement state of its set. Kept for callers
+	from before the replacement policies, it is the same as calling the
+	onHit hook of the policy of the cache.
 */
-void updateLRU(cache_t* cache, uint32_t tag, uint32_t idx, long oldLRU) {
-	long currLRU;
-	uint32_t blockNumber;
-	uint32_t blockNumberStart = idx << log_2(cache->n);
-	for (int i = 0; i < cache->n; i++) {
-		blockNumber = blockNumberStart + i;
-		if (tagEquals(blockNumber, tag, cache) && getValid(cache, blockNumber)) {
-			setLRU(cache, blockNumber, 0);
-		} else {
-			currLRU = getLRU(cache, blockNumber);
-			if (currLRU < oldLRU) {
-				setLRU(cache, blockNumber, currLRU + 1);
-			}
-		}
-	}
+void updateLRU(cache_t* cache, uint32_t blockNumber) {
+	cache->policy->onHit(cache, blockNumber);
 }
+
+/*
+	Takes in an ALIGNED cache, a location in bits as it would be in a PACKED
+	cache with the same parameters, and a value (either 0 or 1) and sets the
+	bit stored for that location to the value passed in.
+*/
+void setAlignedBit(cache_t* cache, uint64_t location, uint8_t value) {
+	uint64_t blockBits = cache->geometry.blockBits;
+	uint8_t lruBits = cache->geometry.lruBits;
+	uint8_t tagBits = cache->geometry.tagBits;
+	location -= cache->geometry.garbageBits;
+	uint32_t blockNumber = (uint32_t) (location / blockBits);
+	uint64_t bit = location % blockBits;
+	if (bit == 0) {
+		setValid(cache, blockNumber, value);
+		return;
+	} else if (bit == 1) {
+		setDirty(cache, blockNumber, value);
+		return;
+	} else if (bit == 2) {
+		setShared(cache, blockNumber, value);
+		return;
+	}
+	bit -= 3;
+	if (bit < lruBits) {
+		uint32_t mask = (uint32_t) 1 << (lruBits - 1 - bit);
+		cache->LRU[blockNumber] = value ? (cache->LRU[blockNumber] | mask) : (cache->LRU[blockNumber] & ~mask);
+		return;
+	}
+	bit -= lruBits;
+	if (bit < tagBits) {
+		uint32_t mask = (uint32_t) 1 << (tagBits - 1 - bit);
+		cache->tags[blockNumber] = value ? (cache->tags[blockNumber] | mask) : (cache->tags[blockNumber] & ~mask);
+		return;
+	}
+	bit -= tagBits;
+	uint8_t* dataByte = cache->data + ((uint64_t) blockNumber * cache->blockDataSize) + (bit >> 3);
+	uint8_t mask = (uint8_t) (1 << (7 - (bit & 7)));
+	*dataByte = value ? (*dataByte | mask) : (*dataByte & ~mask);
+}
\ No newline at end of file
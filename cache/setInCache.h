@@ -48,27 +48,44 @@ void setTag(cache_t* cache, uint32_t tag, uint32_t blockNumber);
 
 /*
 	Takes a newly initialized cache or a cache which has shifted programs and
-	sets all of the valid bits to 0. Effectively clears the cache.
+	sets all of the valid bits to 0. Effectively clears the cache. The dirty
+	and shared bits and the tags are cleared as well, every LRU is set to
+	the reset value of the replacement policy, which is its maximum with
+	LRU, and the set metadata of the policy is cleared. The victim cache is
+	emptied without writing anything back and the prefetcher forgets what it
+	has learned.
 */
 void clearCache(cache_t* cache);
 
 /*
 	Takes in a cache that is switching between programs and clears it, writing
-	an dirty values to memory.
+	an dirty values to memory. The dirty blocks are written in address order
+	in one pass by writeBackAll and physical memory is flushed afterwards, so
+	none of them are left in a write back buffer.
 */
 void contextSwitch(cache_t* cache);
 
 /*
 	Takes in a newly created cache or cleared cache and initialises all LRU 
-	values to be maximal.
+	values to be maximal. With a replacement policy other than LRU the LRU
+	values are set to the reset value of the policy and the set metadata is
+	cleared.
 */
 void initializeLRU(cache_t* cache);
 
 /*
-	Takes a in a cache, the tag, and index of the accessed data
-	along with the original LRU way and updates all of the LRU's in the
-	cache that need to be updated.
+	Takes in a cache and the block number of a block that was just read or
+	written and updates the replacement state of its set. Kept for callers
+	from before the replacement policies, it is the same as calling the
+	onHit hook of the policy of the cache.
 */
-void updateLRU(cache_t* cache, uint32_t tag, uint32_t idx, long old_LRU);
+void updateLRU(cache_t* cache, uint32_t blockNumber);
+
+/*
+	Takes in an ALIGNED cache, a location in bits as it would be in a PACKED
+	cache with the same parameters, and a value (either 0 or 1) and sets the
+	bit stored for that location to the value passed in.
+*/
+void setAlignedBit(cache_t* cache, uint64_t location, uint8_t value);
 
 #endif
\ No newline at end of file
@@ -6,14 +6,23 @@
 #include <string.h>
 #include <unistd.h>
 #include "utils.h"
+#include "bitfield.h"
 #include "getFromCache.h"
 #include "setInCache.h"
 #include "cacheRead.h"
+#include "mem.h"
+#include "memBackend.h"
+#include "replacement.h"
+#include "victimCache.h"
+#include "hierarchy.h"
+#include "prefetch.h"
+#include "sector.h"
 
 /*
-	Used when memory cannot be allocated.
+	Used when memory cannot be allocated. Exits the program, so nothing
+	after a call to it runs.
 */
-void allocationFailed() {
+void allocationFailed(void) {
 	fprintf(stderr, "\nError: allocation failed\n");
     exit(1);
 }
@@ -43,7 +52,60 @@ void physicalMemFailed() {
 */
 cache_t* createCache(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, char* physicalMemoryName) {
 	/* Your Code Here. */
-	if (access(physicalMemoryName, F_OK) == -1) {
+	return createCacheWithOptions(n, blockDataSize, totalDataSize, physicalMemoryName, NULL);
+}
+
+/*
+	Creates a new cache in the same way as createCache but uses the backend
+	passed in as physical memory instead of opening a file by name. The cache
+	takes its own reference to the backend.
+*/
+cache_t* createCacheWithBackend(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, memBackend_t* backend) {
+	cacheOptions_t options = defaultCacheOptions();
+	options.backend = backend;
+	return createCacheWithOptions(n, blockDataSize, totalDataSize, NULL, &options);
+}
+
+/*
+	Returns a cacheOptions struct with every option set to its default
+	value. The default is a PACKED LRU cache whose physical memory is opened
+	by name.
+*/
+cacheOptions_t defaultCacheOptions() {
+	cacheOptions_t options;
+	options.layout = PACKED;
+	options.backend = NULL;
+	options.replacement = LRU_REPLACEMENT;
+	options.policy = NULL;
+	options.seed = 1;
+	options.rripBits = 2;
+	options.victimBlocks = 0;
+	options.prefetch = NO_PREFETCH;
+	options.prefetchDegree = 1;
+	options.prefetchDistance = 1;
+	options.prefetchLatency = 0;
+	options.prefetchOnHit = false;
+	options.writePolicy = WRITE_BACK;
+	options.writeAllocate = true;
+	options.sectorSize = 0;
+	return options;
+}
+
+/*
+	Creates a new cache in the same way as createCache but also takes in a
+	pointer to a cacheOptions struct which selects the optional settings of
+	the cache. If options is NULL the default options are used. The physical
+	memory name is ignored if the options hold a backend.
+*/
+cache_t* createCacheWithOptions(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, char* physicalMemoryName, cacheOptions_t* options) {
+	cacheOptions_t defaults = defaultCacheOptions();
+	if (options == NULL) {
+		options = &defaults;
+	}
+	if (options->backend != NULL) {
+		physicalMemoryName = options->backend->name;
+	}
+	if (physicalMemoryName == NULL || (options->backend == NULL && access(physicalMemoryName, F_OK) == -1)) {
 		physicalMemFailed();
 		return NULL;
 	}
@@ -62,6 +124,15 @@ cache_t* createCache(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize,
 		invalidCache();
 		return NULL;
 	}
+	if (options->rripBits < 2 || options->rripBits > 3) {
+		invalidCache();
+		return NULL;
+	}
+	if (options->sectorSize != 0 && (!oneBitOn(options->sectorSize) || options->sectorSize >= blockDataSize
+		|| blockDataSize / options->sectorSize > MAX_SECTORS || options->victimBlocks != 0)) {
+		invalidCache();
+		return NULL;
+	}
 
 	// Initiate cache
 	cache_t* newCache = (cache_t *) malloc(sizeof(cache_t));
@@ -83,21 +154,169 @@ cache_t* createCache(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize,
 	newCache->n = n;
 	newCache->blockDataSize = blockDataSize;
 	newCache->totalDataSize = totalDataSize;
-
-	// set contents to size of cache
-	newCache->contents = (uint8_t *) malloc(cacheSizeBytes(newCache));
-	if (!(newCache->contents)) {
-		free(newCache->contents);
+	newCache->policy = options->policy != NULL ? options->policy : getReplacementPolicy(options->replacement);
+	newCache->randomState = options->seed != 0 ? options->seed : 1;
+	newCache->rripBits = options->rripBits;
+	newCache->replacement = options->replacement;
+	newCache->psel = 1 << (PSEL_BITS - 1);
+	newCache->writePolicy = options->writePolicy;
+	newCache->writeAllocate = options->writeAllocate;
+	newCache->sectorSize = options->sectorSize;
+	computeGeometry(newCache);
+
+	// the block metadata must fit in an LRU entry and the set metadata in a word
+	bool dueling = options->policy == NULL
+		&& (options->replacement == DRRIP_REPLACEMENT || options->replacement == DIP_REPLACEMENT);
+	if (newCache->geometry.lruBits > 32 || newCache->geometry.setBits > 64
+		|| (dueling && newCache->geometry.numSets < MIN_DUELING_SETS)) {
 		free(newCache->physicalMemoryName);
 		free(newCache);
+		invalidCache();
+		return NULL;
+	}
+	newCache->layout = options->layout;
+	newCache->contents = NULL;
+	newCache->tags = NULL;
+	newCache->flags = NULL;
+	newCache->LRU = NULL;
+	newCache->data = NULL;
+	newCache->backend = NULL;
+	newCache->setState = NULL;
+	newCache->victim = NULL;
+	newCache->prefetcher = NULL;
+	newCache->sectorValid = NULL;
+	newCache->sectorDirty = NULL;
+	newCache->inclusion = NINE_LEVEL;
+	newCache->levelBackend = NULL;
+	newCache->uppers = NULL;
+	newCache->numUppers = 0;
+	newCache->blockBuffers = NULL;
+	newCache->numBlockBuffers = 0;
+	newCache->blockBuffersInUse = 0;
+
+	if (newCache->layout == ALIGNED) {
+		// one entry per block in each metadata array and blocks placed on block boundaries
+		uint32_t numBlocks = totalDataSize / blockDataSize;
+		size_t alignment = blockDataSize < sizeof(void*) ? sizeof(void*) : blockDataSize;
+		if (alignment > 4096) {
+			alignment = 4096;
+		}
+		newCache->tags = (uint32_t *) malloc(sizeof(uint32_t) * numBlocks);
+		newCache->flags = (uint8_t *) malloc(sizeof(uint8_t) * numBlocks);
+		newCache->LRU = (uint32_t *) malloc(sizeof(uint32_t) * numBlocks);
+		if (posix_memalign((void **) &(newCache->data), alignment, totalDataSize) != 0) {
+			newCache->data = NULL;
+		}
+		if (!(newCache->tags) || !(newCache->flags) || !(newCache->LRU) || !(newCache->data)) {
+			free(newCache->tags);
+			free(newCache->flags);
+			free(newCache->LRU);
+			free(newCache->data);
+			free(newCache->physicalMemoryName);
+			free(newCache);
+			allocationFailed();
+		}
+		memset(newCache->flags, 0, numBlocks);
+		memset(newCache->data, 0, totalDataSize);
+	} else {
+		// set contents to size of cache with room for whole word field accesses at the end
+		newCache->contents = (uint8_t *) calloc(cacheSizeBytes(newCache) + BITFIELD_PADDING, sizeof(uint8_t));
+		if (!(newCache->contents)) {
+			free(newCache->contents);
+			free(newCache->physicalMemoryName);
+			free(newCache);
+			allocationFailed();
+		}
+	}
+
+	// the set metadata of the replacement policy is packed like the blocks
+	uint64_t setStateBytes = ((uint64_t) newCache->geometry.numSets * newCache->geometry.setBits + 7) >> 3;
+	newCache->setState = (uint8_t *) calloc(setStateBytes + BITFIELD_PADDING, sizeof(uint8_t));
+	if (!(newCache->setState)) {
+		deleteCache(newCache);
 		allocationFailed();
 	}
 
+	// whole blocks moved on a miss live in these instead of on the stack
+	newCache->blockBuffers = (uint8_t **) calloc(BLOCK_BUFFERS, sizeof(uint8_t *));
+	if (!(newCache->blockBuffers)) {
+		deleteCache(newCache);
+		allocationFailed();
+	}
+	newCache->numBlockBuffers = BLOCK_BUFFERS;
+	for (uint32_t i = 0; i < BLOCK_BUFFERS; i++) {
+		newCache->blockBuffers[i] = (uint8_t *) malloc(sizeof(uint8_t) * blockDataSize);
+		if (!(newCache->blockBuffers[i])) {
+			deleteCache(newCache);
+			allocationFailed();
+		}
+	}
+
+	if (options->victimBlocks != 0) {
+		newCache->victim = createVictimCache(options->victimBlocks, blockDataSize);
+	}
+	newCache->prefetcher = createPrefetcher(newCache, options);
+	if (newCache->sectorSize != 0) {
+		newCache->sectorValid = (uint64_t *) calloc(newCache->geometry.numBlocks, sizeof(uint64_t));
+		newCache->sectorDirty = (uint64_t *) calloc(newCache->geometry.numBlocks, sizeof(uint64_t));
+		if (!(newCache->sectorValid) || !(newCache->sectorDirty)) {
+			deleteCache(newCache);
+			allocationFailed();
+		}
+	}
+
+	// share the backend of any other cache using the same physical memory
+	if (options->backend != NULL) {
+		newCache->backend = retainMemBackend(options->backend);
+	} else {
+		newCache->backend = openMemBackend(physicalMemoryName, AUTO_BACKEND);
+	}
+	if (newCache->backend == NULL) {
+		physicalMemFailed();
+		deleteCache(newCache);
+		return NULL;
+	}
+	if (linkUpperLevel(newCache) == -1) {
+		invalidCache();
+		deleteCache(newCache);
+		return NULL;
+	}
+
 	// invalidate every block and set LRU values to maximum
 	clearCache(newCache);
 	return newCache;
 }
 
+/*
+	Takes in a cache with n, blockDataSize, totalDataSize, and its
+	replacement policy set and fills in its geometry. Called once by
+	createCache.
+*/
+void computeGeometry(cache_t* cache) {
+	geometry_t* geometry = &(cache->geometry);
+	geometry->offsetBits = log_2(cache->blockDataSize);
+	geometry->waysBits = log_2(cache->n);
+	geometry->sectorShift = log_2(cache->sectorSize != 0 ? cache->sectorSize : cache->blockDataSize);
+	geometry->numSectors = cache->blockDataSize >> geometry->sectorShift;
+	geometry->numSets = cache->totalDataSize / cache->blockDataSize / cache->n;
+	geometry->numBlocks = cache->totalDataSize / cache->blockDataSize;
+	geometry->indexBits = log_2(geometry->numSets);
+	geometry->tagBits = 32 - geometry->offsetBits - geometry->indexBits;
+	geometry->lruBits = cache->policy->blockBits(cache);
+	geometry->setBits = cache->policy->setBits(cache);
+	geometry->indexShift = geometry->offsetBits;
+	geometry->tagShift = geometry->offsetBits + geometry->indexBits;
+	geometry->offsetMask = (uint32_t) ((UINT64_C(1) << geometry->offsetBits) - 1);
+	geometry->indexMask = (uint32_t) ((UINT64_C(1) << geometry->indexBits) - 1);
+
+	// valid, dirty, and shared come first followed by the LRU, tag, and data
+	geometry->lruStart = 3;
+	geometry->tagStart = geometry->lruStart + geometry->lruBits;
+	geometry->dataStart = geometry->tagStart + geometry->tagBits;
+	geometry->blockBits = geometry->dataStart + ((uint64_t) cache->blockDataSize << 3);
+	geometry->garbageBits = (uint8_t) ((8 - ((geometry->numBlocks * geometry->blockBits) & 7)) & 7);
+}
+
 /*
 	Function that frees all of the memory taken up by a cache.
 */
@@ -105,11 +324,65 @@ void deleteCache(cache_t* cache) {
 	if (cache == NULL) {
 		return;
 	}
+	unlinkUpperLevel(cache);
+	releaseMemBackend(cache->backend);
 	free(cache->physicalMemoryName);
 	free(cache->contents);
+	free(cache->tags);
+	free(cache->flags);
+	free(cache->LRU);
+	free(cache->data);
+	free(cache->setState);
+	deleteVictimCache(cache->victim);
+	deletePrefetcher(cache->prefetcher);
+	free(cache->sectorValid);
+	free(cache->sectorDirty);
+	free(cache->uppers);
+	if (cache->blockBuffers != NULL) {
+		for (uint32_t i = 0; i < cache->numBlockBuffers; i++) {
+			free(cache->blockBuffers[i]);
+		}
+		free(cache->blockBuffers);
+	}
 	free(cache);
 }
 
+/*
+	Takes in a cache and returns a buffer of blockDataSize bytes for a block
+	that is being moved into or out of the cache, so that no whole block is
+	put on the stack. Buffers are handed out like a stack and the function
+	that takes one gives it back with releaseBlockBuffer before it returns.
+	A miss that starts while another is using a buffer, which happens when
+	a lower level invalidates blocks of the cache, takes the next buffer,
+	and more are allocated once all of them are in use.
+*/
+uint8_t* takeBlockBuffer(cache_t* cache) {
+	if (cache->blockBuffersInUse == cache->numBlockBuffers) {
+		uint32_t count = cache->numBlockBuffers << 1;
+		uint8_t** buffers = (uint8_t **) realloc(cache->blockBuffers, sizeof(uint8_t *) * count);
+		if (buffers == NULL) {
+			allocationFailed();
+		}
+		for (uint32_t i = cache->numBlockBuffers; i < count; i++) {
+			buffers[i] = (uint8_t *) malloc(sizeof(uint8_t) * cache->blockDataSize);
+			if (buffers[i] == NULL) {
+				allocationFailed();
+			}
+		}
+		cache->blockBuffers = buffers;
+		cache->numBlockBuffers = count;
+	}
+	return cache->blockBuffers[cache->blockBuffersInUse++];
+}
+
+/*
+	Takes in a cache and gives back the buffer that was taken from it last
+	by takeBlockBuffer.
+*/
+void releaseBlockBuffer(cache_t* cache) {
+	cache->blockBuffersInUse--;
+}
+
 /*
 	Takes in a memory address and the cache it will be written to and
 	returns the value of the tag as the rightmost bits with leading
@@ -119,13 +392,7 @@ uint32_t getTag(cache_t* cache, uint32_t address) {
 	if (cache == NULL) {
 		return 0;
 	}
-
-	// tag size shouldn't be 0?
-	uint32_t len = getTagSize(cache);
-	if (len == 0) {
-		return 0;
-	}
-	return address >> (32 - len);
+	return address >> cache->geometry.tagShift;
 }
 
 /*
@@ -137,17 +404,7 @@ uint32_t getIndex(cache_t* cache, uint32_t address) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint32_t tagBits = getTagSize(cache);
-	uint32_t offsetBits = log_2(cache->blockDataSize);
-	uint32_t indexBits = 32 - offsetBits - tagBits;
-	if ((log_2(cache->totalDataSize) - log_2(cache->blockDataSize) - log_2(cache->n)) == 0) {
-		return 0;
-	} else {
-		uint32_t shiftedVal = (uint32_t) (address >> offsetBits);
-		uint32_t mask = (uint32_t) pow(2, indexBits) - 1;
-
-		return (shiftedVal & mask);
-	}
+	return (address >> cache->geometry.indexShift) & cache->geometry.indexMask;
 }
 
 /*
@@ -159,10 +416,7 @@ uint32_t getOffset(cache_t* cache, uint32_t address) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint32_t offsetBits = log_2(cache->blockDataSize);
-	uint32_t mask = (uint32_t) pow(2, offsetBits) - 1;
-
-	return (address & mask);
+	return address & cache->geometry.offsetMask;
 }
 
 /*
@@ -173,8 +427,7 @@ uint32_t getNumSets(cache_t* cache) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint32_t numSets = (cache->totalDataSize / cache->blockDataSize / cache->n);
-	return numSets;
+	return cache->geometry.numSets;
 }
 
 /*
@@ -185,9 +438,7 @@ uint8_t getTagSize(cache_t* cache) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint8_t offsetBits = log_2(cache->blockDataSize);
-	uint8_t indexBits = log_2(cache->totalDataSize / cache->blockDataSize / cache->n);
-	return 32 - offsetBits - indexBits;
+	return cache->geometry.tagBits;
 }
 
 /*
@@ -198,7 +449,7 @@ uint8_t numLRUBits(cache_t* cache) {
 	if (cache == NULL) {
 		return 0;
 	}
-	return log_2(cache->n);
+	return cache->geometry.lruBits;
 }
 
 /*
@@ -208,11 +459,7 @@ uint64_t totalBlockBits(cache_t* cache) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint64_t tagBits = (uint64_t) getTagSize(cache);
-	uint64_t lruBits = (uint64_t) numLRUBits(cache);
-	uint64_t blockSize = (uint64_t) cache->blockDataSize * 8;
-	uint64_t total = blockSize + 3 + tagBits + lruBits;
-	return total;
+	return cache->geometry.blockBits;
 }
 
 /*
@@ -222,8 +469,7 @@ uint64_t cacheSizeBits(cache_t* cache) {
 	if (cache == NULL) {
 		return 0;
 	}
-	uint64_t cacheBits = (cache->totalDataSize / cache->blockDataSize) * totalBlockBits(cache);
-	return cacheBits;
+	return (uint64_t) cache->geometry.numBlocks * cache->geometry.blockBits;
 }
 
 /*
@@ -247,7 +493,7 @@ uint64_t cacheSizeBytes(cache_t* cache) {
 	should always be accounted for.
 */
 uint8_t numGarbageBits(cache_t* cache) {
-	return (uint8_t) ((8 - (cacheSizeBits(cache) & 7)) & 7);
+	return cache->geometry.garbageBits;
 }
 
 /*
@@ -256,9 +502,7 @@ uint8_t numGarbageBits(cache_t* cache) {
 */
 uint64_t getBlockStartBits(cache_t* cache, uint32_t blocknumber) {
 	/* Your Code Here. */
-	uint64_t blockBits = totalBlockBits(cache);
-	uint64_t blockIndex = blocknumber * blockBits;
-	return blockIndex + (uint64_t) numGarbageBits(cache);
+	return ((uint64_t) blocknumber * cache->geometry.blockBits) + cache->geometry.garbageBits;
 }
 
 /*
@@ -279,7 +523,9 @@ int tagEquals(uint32_t blockNumber, uint32_t tag, cache_t* cache) {
 	hexadecimal. A horizontal line should begin and end the cache. Every
 	entry should be on a new line. A space and a verticle line should
 	separate each column in each row. A newline space should also be printed
-	after each cache.
+	after each cache. If the replacement policy keeps set metadata, such as
+	the tree of PLRU, it is printed in binary after the blocks of each set
+	with the bit of tree node 1 first.
 	EX:
 
 	-----------------------------------------------
@@ -292,20 +538,20 @@ int tagEquals(uint32_t blockNumber, uint32_t tag, cache_t* cache) {
 
 */
 void printCache(cache_t* cache) {
-	uint8_t* data;
+	uint8_t* data = takeBlockBuffer(cache);
 	uint32_t sets = getNumSets(cache);
 	uint32_t iterations = cache->n;
 	uint64_t blockDataSize = cache->blockDataSize;
 	printf("----------------------------------------------------\n");
 	printf("set | valid | dirty | shared | LRU | tag | data\n");
 	for (uint64_t i = 0; i < sets * iterations; i++) {
-		printf("%ld | ", (i >> log_2(iterations)));
+		printf("%ld | ", (i >> cache->geometry.waysBits));
 		printf("%d | ", getValid(cache, i));
 		printf("%d | ", getDirty(cache, i));
 		printf("%d | ", getShared(cache, i));
 		printf("%ld | ", getLRU(cache, i));
 		printf("0x%x | ", extractTag(cache, i));
-		data = fetchBlock(cache, i);
+		fetchBlockInto(cache, i, data);
 		printf("0x");
 		for (uint64_t j = 0; j < blockDataSize; j++) {
 			if (data[j] < 16) {
@@ -313,10 +559,18 @@ void printCache(cache_t* cache) {
 			}
 			printf("%x", data[j]);
 		}
-		free(data);
 		printf("\n");
+		if (cache->geometry.setBits > 0 && (i & (iterations - 1)) == iterations - 1) {
+			uint64_t state = getSetState(cache, (uint32_t) (i >> cache->geometry.waysBits));
+			printf("%ld | state | ", (i >> cache->geometry.waysBits));
+			for (uint8_t j = 0; j < cache->geometry.setBits; j++) {
+				printf("%d", (int) ((state >> j) & 1));
+			}
+			printf("\n");
+		}
 	}
 	printf("----------------------------------------------------\n");
+	releaseBlockBuffer(cache);
 }
 
 /*
@@ -370,7 +624,7 @@ uint64_t getSharedLocation(cache_t* cache, uint32_t blockNumber) {
 */
 uint64_t getLRULocation(cache_t* cache, uint32_t blockNumber) {
 	/* Your Code Here. */
-	return getBlockStartBits(cache, blockNumber) + 3;
+	return getBlockStartBits(cache, blockNumber) + cache->geometry.lruStart;
 }
 
 /*
@@ -379,7 +633,7 @@ uint64_t getLRULocation(cache_t* cache, uint32_t blockNumber) {
 */
 uint64_t getTagLocation(cache_t* cache, uint32_t blockNumber) {
 	/* Your Code Here. */
-	return getBlockStartBits(cache, blockNumber) + (uint64_t) 3 + (uint64_t) numLRUBits(cache);
+	return getBlockStartBits(cache, blockNumber) + cache->geometry.tagStart;
 }
 
 /*
@@ -389,5 +643,5 @@ uint64_t getTagLocation(cache_t* cache, uint32_t blockNumber) {
 */
 uint64_t getDataLocation(cache_t* cache, uint32_t blockNumber, uint32_t offset) {
 	/* Your Code Here. */
-	return getTagLocation(cache, blockNumber) + (uint64_t) getTagSize(cache) + (uint64_t) (offset * 8);
+	return getBlockStartBits(cache, blockNumber) + cache->geometry.dataStart + ((uint64_t) offset << 3);
 }
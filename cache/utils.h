@@ -2,13 +2,196 @@
 #ifndef UTILS_H
 #define UTILS_H
 
+/*
+	Enum used to select how a cache stores its blocks. PACKED stores every
+	block as one run of bits inside of contents. ALIGNED stores the tags,
+	flags, and LRU values in separate word sized arrays and the data of every
+	block in a block aligned array so no bit manipulation is needed.
+*/
+enum layout {PACKED, ALIGNED};
+
+/*
+	Enum used to select one of the stock replacement policies. LRU evicts
+	the least recently used block, FIFO evicts the block that was placed in
+	its set first, RANDOM evicts a block chosen by a seeded pseudo random
+	number generator, and MRU evicts the most recently used block. RANDOM
+	and MRU fill a block that is not valid first. PLRU is tree pseudo LRU,
+	which keeps n - 1 bits per set instead of an LRU value per block.
+	SRRIP, BRRIP, and DRRIP keep a re-reference prediction value of 2 or 3
+	bits per block so that a scan cannot push the blocks that are reused out
+	of the cache. SRRIP inserts new blocks with a long re-reference
+	interval, BRRIP inserts them with a distant one most of the time, and
+	DRRIP uses whichever of the two misses less in a few leader sets.
+	LIP, BIP, and DIP keep the LRU stack but change where a new block is
+	inserted. LIP inserts it at the LRU position, BIP inserts it at the MRU
+	position once in 32 fills and at the LRU position otherwise, and DIP
+	uses whichever of LRU and BIP misses less in a few leader sets. DRRIP
+	and DIP need at least MIN_DUELING_SETS sets.
+	STAMP_LRU picks the same victims as LRU but stores a 32 bit timestamp
+	per block and a clock per set, so a hit only writes the block that was
+	used instead of every block of the set.
+*/
+enum replacement {LRU_REPLACEMENT, FIFO_REPLACEMENT, RANDOM_REPLACEMENT, MRU_REPLACEMENT, PLRU_REPLACEMENT,
+	SRRIP_REPLACEMENT, BRRIP_REPLACEMENT, DRRIP_REPLACEMENT, LIP_REPLACEMENT, BIP_REPLACEMENT, DIP_REPLACEMENT,
+	STAMP_LRU_REPLACEMENT};
+
+/*
+	Enum used to select the prefetcher attached to a cache. NEXT_LINE_PREFETCH
+	prefetches the blocks that follow the block that was accessed and
+	STRIDE_PREFETCH detects a constant stride between the blocks accessed in
+	a region of memory and prefetches along it.
+*/
+enum prefetchType {NO_PREFETCH, NEXT_LINE_PREFETCH, STRIDE_PREFETCH};
+
+/*
+	Enum used to select when a cache writes to physical memory. WRITE_BACK
+	marks a written block dirty and writes it back when it is evicted.
+	WRITE_THROUGH writes the bytes of every store to physical memory as well
+	as to the cache, so its blocks are never dirty.
+*/
+enum writePolicy {WRITE_BACK, WRITE_THROUGH};
+
+/*
+	Enum used to select how a cache that is the next level below other
+	caches relates to them. NINE_LEVEL neither keeps nor avoids copies of
+	the blocks of its upper levels. INCLUSIVE_LEVEL holds every block its
+	upper levels hold and invalidates their copies when it evicts one.
+	EXCLUSIVE_LEVEL only holds blocks its upper levels have evicted.
+*/
+enum inclusion {NINE_LEVEL, INCLUSIVE_LEVEL, EXCLUSIVE_LEVEL};
+
+/*
+	Number of bits in the policy selection counter used by the set dueling
+	replacement policies.
+*/
+#define PSEL_BITS 10
+
+/*
+	Smallest number of sets a cache using a set dueling replacement policy
+	can have. Every group of this many sets holds one leader set of each
+	policy and at least two follower sets.
+*/
+#define MIN_DUELING_SETS 4
+
+/*
+	Number of block buffers a cache is created with. A cache only needs
+	more when misses nest, which takes a multi-level hierarchy.
+*/
+#define BLOCK_BUFFERS 4
+
+/*
+	Masks for the valid, dirty, and shared bits inside of a flags entry of
+	an ALIGNED cache.
+*/
+#define VALID_FLAG 1
+#define DIRTY_FLAG 2
+#define SHARED_FLAG 4
+
+/*
+	Struct used to hold the optional settings for a cache that are
+	chosen when it is created. Use defaultCacheOptions to get a struct
+	with every setting at its default value. If backend is not NULL the
+	cache uses it as physical memory instead of opening the file by name.
+	The replacement selects a stock replacement policy unless policy is not
+	NULL, in which case policy is used instead and the replacement is only
+	recorded in the cache. The seed starts the pseudo
+	random number generator used by the replacement policy and RRIP bits is
+	the width of the re-reference prediction values of the RRIP policies,
+	which must be 2 or 3. If victim blocks is not 0 the cache gets a fully
+	associative victim cache with that many blocks. The prefetch selects a
+	prefetcher, which is given the degree, distance, latency, and whether it
+	also runs on hits by the remaining fields. The degree and distance
+	default to 1. The write policy defaults to WRITE_BACK and write allocate
+	defaults to true. Without write allocate a store that misses is written
+	to physical memory and no block is placed in the cache. If sector size
+	is not 0 every block is split into sectors of that many bytes with
+	their own valid and dirty bits. It must be a power of two smaller than
+	the block size, a block can have at most MAX_SECTORS sectors, and a
+	sectored cache cannot have a victim cache.
+*/
+typedef struct cacheOptions
+{
+	enum layout layout;
+	struct memBackend* backend;
+	enum replacement replacement;
+	const struct replacementPolicy* policy;
+	uint64_t seed;
+	uint8_t rripBits;
+	uint32_t victimBlocks;
+	enum prefetchType prefetch;
+	uint32_t prefetchDegree;
+	uint32_t prefetchDistance;
+	uint32_t prefetchLatency;
+	bool prefetchOnHit;
+	enum writePolicy writePolicy;
+	bool writeAllocate;
+	uint32_t sectorSize;
+} cacheOptions_t;
+
+/*
+	Struct used to hold the address geometry of a cache. It is computed once
+	when the cache is created so that decoding an address or finding a field
+	inside of a block only needs shifts and masks. The shift fields are the
+	amount an address is shifted right by to reach that part of the T:I:O,
+	the field offsets are in bits from the start of a block, and the garbage
+	bits are the padding bits at the front of a PACKED cache. The LRU bits
+	and set bits are the block and set metadata sizes of the replacement
+	policy. The sector shift is the log of the sector size and a cache that
+	is not sectored has one sector per block.
+*/
+typedef struct geometry
+{
+	uint8_t offsetBits;
+	uint8_t indexBits;
+	uint8_t tagBits;
+	uint8_t lruBits;
+	uint8_t setBits;
+	uint8_t waysBits;
+	uint8_t sectorShift;
+	uint8_t indexShift;
+	uint8_t tagShift;
+	uint8_t garbageBits;
+	uint32_t offsetMask;
+	uint32_t indexMask;
+	uint32_t numSets;
+	uint32_t numBlocks;
+	uint32_t numSectors;
+	uint64_t blockBits;
+	uint64_t lruStart;
+	uint64_t tagStart;
+	uint64_t dataStart;
+} geometry_t;
+
 /*
 	Struct to be used to represent a cache. Both the block data size
 	and the total data size is given in bytes. The physical Memory Name
 	is the name of the file which will function as main memory for the
 	cache. The access and hit fields are used to track cache accesses
 	and are used for hit rate. This will be implemented in part 2 of
-	the project.
+	the project. The layout determines whether the blocks live in contents
+	or in the tags, flags, LRU and data arrays, which are NULL for a PACKED
+	cache. The geometry is filled in by createCache and must not change
+	afterwards. The backend is the physical memory the cache reads from and
+	writes back to and the cache holds one reference to it. The policy
+	chooses which block is evicted, the set state holds its set metadata,
+	and the random state is the state of its random number generator. The
+	RRIP bits are used by the RRIP policies and psel is the policy selection
+	counter of the set dueling policies. The replacement is the stock policy
+	that was selected when the cache was created. The victim is the victim
+	cache of the cache or NULL if it has none and the victim hit, swap, and
+	write back fields count how often it was used like access and hit. The
+	prefetcher is the prefetcher of the cache or NULL if it has none. The
+	write policy and write allocate are copied from the options. A sectored
+	cache has a sector size that is not 0 and keeps the valid and dirty bits
+	of the sectors of every block in sector valid and sector dirty, with the
+	bit of sector 0 lowest. The valid and dirty bits of a block say whether
+	the block holds a tag and whether any of its sectors are dirty. A cache
+	that is the next level below other caches has a level backend they read
+	and write through, its inclusion policy, and the caches above it in
+	uppers. Back invalidations counts the blocks its evictions removed from
+	them. The block buffers are scratch space for whole blocks that are
+	handed out by takeBlockBuffer, and the first blockBuffersInUse of them
+	are taken.
 */
 typedef struct cache
 {
@@ -19,6 +202,37 @@ typedef struct cache
 	char* physicalMemoryName;
 	double access;
 	double hit;
+	enum layout layout;
+	uint32_t* tags;
+	uint8_t* flags;
+	uint32_t* LRU;
+	uint8_t* data;
+	geometry_t geometry;
+	struct memBackend* backend;
+	const struct replacementPolicy* policy;
+	uint8_t* setState;
+	uint64_t randomState;
+	uint8_t rripBits;
+	uint32_t psel;
+	enum replacement replacement;
+	struct victimCache* victim;
+	double victimHit;
+	double victimSwap;
+	double victimWriteBack;
+	struct prefetcher* prefetcher;
+	enum writePolicy writePolicy;
+	bool writeAllocate;
+	uint32_t sectorSize;
+	uint64_t* sectorValid;
+	uint64_t* sectorDirty;
+	enum inclusion inclusion;
+	struct memBackend* levelBackend;
+	struct cache** uppers;
+	uint32_t numUppers;
+	double backInvalidations;
+	uint8_t** blockBuffers;
+	uint32_t numBlockBuffers;
+	uint32_t blockBuffersInUse;
 } cache_t;
 
 /*
@@ -78,9 +292,10 @@ typedef struct doubleWordInfo
 } doubleWordInfo_t;
 
 /*
-	Used when memory cannot be allocated.
+	Used when memory cannot be allocated. Exits the program, so nothing
+	after a call to it runs.
 */
-void allocationFailed();
+void allocationFailed(void) __attribute__((noreturn));
 
 /*
 	Used to indicate the cache specs given are invalid.
@@ -103,11 +318,57 @@ void physicalMemFailed();
 */ 
 cache_t* createCache(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, char* physicalMemoryName);
 
+/*
+	Creates a new cache in the same way as createCache but uses the backend
+	passed in as physical memory instead of opening a file by name. The cache
+	takes its own reference to the backend.
+*/
+cache_t* createCacheWithBackend(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, struct memBackend* backend);
+
+/*
+	Returns a cacheOptions struct with every option set to its default
+	value. The default is a PACKED LRU cache whose physical memory is opened
+	by name.
+*/
+cacheOptions_t defaultCacheOptions();
+
+/*
+	Creates a new cache in the same way as createCache but also takes in a
+	pointer to a cacheOptions struct which selects the optional settings of
+	the cache. If options is NULL the default options are used. The physical
+	memory name is ignored if the options hold a backend.
+*/
+cache_t* createCacheWithOptions(uint32_t n, uint32_t blockDataSize, uint32_t totalDataSize, char* physicalMemoryName, cacheOptions_t* options);
+
+/*
+	Takes in a cache with n, blockDataSize, totalDataSize, and its
+	replacement policy set and fills in its geometry. Called once by
+	createCache.
+*/
+void computeGeometry(cache_t* cache);
+
 /*
 	Function that frees all of the memory taken up by a cache.
 */
 void deleteCache(cache_t* cache);
 
+/*
+	Takes in a cache and returns a buffer of blockDataSize bytes for a block
+	that is being moved into or out of the cache, so that no whole block is
+	put on the stack. Buffers are handed out like a stack and the function
+	that takes one gives it back with releaseBlockBuffer before it returns.
+	A miss that starts while another is using a buffer, which happens when
+	a lower level invalidates blocks of the cache, takes the next buffer,
+	and more are allocated once all of them are in use.
+*/
+uint8_t* takeBlockBuffer(cache_t* cache);
+
+/*
+	Takes in a cache and gives back the buffer that was taken from it last
+	by takeBlockBuffer.
+*/
+void releaseBlockBuffer(cache_t* cache);
+
 /*
 	Takes in a memory address and the cache it will be written to and
 	returns the value of the tag as the rightmost bits with leading
@@ -188,7 +449,9 @@ int tagEquals(uint32_t blockNumber, uint32_t tag, cache_t* cache);
 	hexadecimal. A horizontal line should begin and end the cache. Every 
 	entry should be on a new line. A space and a verticle line should 
 	separate each column in each row. A newline space should also be printed
-	after each cache.
+	after each cache. If the replacement policy keeps set metadata, such as
+	the tree of PLRU, it is printed in binary after the blocks of each set
+	with the bit of tree node 1 first.
 	EX:
 
 	-----------------------------------------------
@@ -0,0 +1,195 @@
+/* Summer 2017 */
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "victimCache.h"
+#include "getFromCache.h"
+#include "cacheRead.h"
+#include "mem.h"
+#include "hierarchy.h"
+#include "../hitrate/hitRate.h"
+
+/*
+	Compares two victim cache addresses for qsort.
+*/
+static int compareAddresses(const void* first, const void* second) {
+	uint32_t a = *(const uint32_t*) first;
+	uint32_t b = *(const uint32_t*) second;
+	return a < b ? -1 : (a > b);
+}
+
+/*
+	Takes in a victim cache and an address and returns the entry that holds
+	the block at the address. Returns numBlocks if no entry holds it.
+*/
+static uint32_t findVictimEntry(victimCache_t* victim, uint32_t address) {
+	for (uint32_t i = 0; i < victim->numBlocks; i++) {
+		if ((victim->flags[i] & VALID_FLAG) && victim->addresses[i] == address) {
+			return i;
+		}
+	}
+	return victim->numBlocks;
+}
+
+/*
+	Creates an empty victim cache that holds numBlocks blocks of
+	blockDataSize bytes. Returns NULL if numBlocks is 0.
+*/
+victimCache_t* createVictimCache(uint32_t numBlocks, uint32_t blockDataSize) {
+	if (numBlocks == 0) {
+		return NULL;
+	}
+	victimCache_t* victim = malloc(sizeof(victimCache_t));
+	if (victim == NULL) {
+		allocationFailed();
+	}
+	victim->numBlocks = numBlocks;
+	victim->blockDataSize = blockDataSize;
+	victim->addresses = malloc(sizeof(uint32_t) * numBlocks);
+	victim->flags = malloc(sizeof(uint8_t) * numBlocks);
+	victim->stamps = malloc(sizeof(uint64_t) * numBlocks);
+	victim->data = malloc(sizeof(uint8_t) * numBlocks * blockDataSize);
+	if (!(victim->addresses) || !(victim->flags) || !(victim->stamps) || !(victim->data)) {
+		deleteVictimCache(victim);
+		allocationFailed();
+	}
+	clearVictimCache(victim);
+	return victim;
+}
+
+/*
+	Frees a victim cache without writing any of its blocks back.
+*/
+void deleteVictimCache(victimCache_t* victim) {
+	if (victim == NULL) {
+		return;
+	}
+	free(victim->addresses);
+	free(victim->flags);
+	free(victim->stamps);
+	free(victim->data);
+	free(victim);
+}
+
+/*
+	Takes in a victim cache and invalidates every entry without writing any
+	of them back.
+*/
+void clearVictimCache(victimCache_t* victim) {
+	if (victim == NULL) {
+		return;
+	}
+	memset(victim->addresses, 0, sizeof(uint32_t) * victim->numBlocks);
+	memset(victim->flags, 0, victim->numBlocks);
+	memset(victim->stamps, 0, sizeof(uint64_t) * victim->numBlocks);
+	victim->clock = 0;
+}
+
+/*
+	Takes in a cache and the address of the block that missed in it. If the
+	victim cache of the cache holds the block it is copied into data and
+	removed from the victim cache, the hit is reported, and its dirty bit is
+	returned. Returns -1 if the cache has no victim cache or the block is
+	not in it.
+*/
+int takeFromVictimCache(cache_t* cache, uint32_t address, uint8_t* data) {
+	victimCache_t* victim = cache->victim;
+	if (victim == NULL) {
+		return -1;
+	}
+	uint32_t entry = findVictimEntry(victim, address);
+	if (entry == victim->numBlocks) {
+		return -1;
+	}
+	memcpy(data, victim->data + (uint64_t) entry * victim->blockDataSize, victim->blockDataSize);
+	int dirty = (victim->flags[entry] & DIRTY_FLAG) != 0;
+	victim->flags[entry] = 0;
+	reportVictimHit(cache);
+	return dirty;
+}
+
+/*
+	Takes in a cache and length bytes of data to be written at address. If
+	the victim cache of the cache holds the block of the address the data is
+	written into it and the entry is marked dirty if dirty is set. Returns 1
+	if the block was held and 0 otherwise, including when the cache has no
+	victim cache.
+*/
+int writeToVictimCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length, uint8_t dirty) {
+	victimCache_t* victim = cache->victim;
+	if (victim == NULL) {
+		return 0;
+	}
+	uint32_t block = address & ~(cache->geometry.offsetMask);
+	uint32_t entry = findVictimEntry(victim, block);
+	if (entry == victim->numBlocks) {
+		return 0;
+	}
+	memcpy(victim->data + (uint64_t) entry * victim->blockDataSize + (address - block), data, length);
+	if (dirty) {
+		victim->flags[entry] |= DIRTY_FLAG;
+	}
+	return 1;
+}
+
+/*
+	Takes in a cache and the block number of a block that is being evicted
+	and places the block in the victim cache of the cache. If the victim
+	cache is full its oldest entry is replaced and written back to memory if
+	it is dirty. Blocks that are not valid are ignored.
+*/
+void evictToVictimCache(cache_t* cache, uint32_t blockNumber) {
+	victimCache_t* victim = cache->victim;
+	if (!getValid(cache, blockNumber)) {
+		return;
+	}
+	backInvalidate(cache, blockNumber);
+
+	// an empty entry is used first and otherwise the oldest one is replaced
+	uint32_t entry = 0;
+	for (uint32_t i = 0; i < victim->numBlocks; i++) {
+		if (!(victim->flags[i] & VALID_FLAG)) {
+			entry = i;
+			break;
+		}
+		if (victim->stamps[i] < victim->stamps[entry]) {
+			entry = i;
+		}
+	}
+	uint8_t* block = victim->data + (uint64_t) entry * victim->blockDataSize;
+	if ((victim->flags[entry] & (VALID_FLAG | DIRTY_FLAG)) == (VALID_FLAG | DIRTY_FLAG)) {
+		writeBytesToMem(cache, victim->addresses[entry], block, victim->blockDataSize);
+		reportVictimWriteBack(cache);
+	}
+	victim->addresses[entry] = extractAddress(cache, extractTag(cache, blockNumber), blockNumber, 0);
+	victim->flags[entry] = VALID_FLAG | (getDirty(cache, blockNumber) ? DIRTY_FLAG : 0);
+	victim->stamps[entry] = ++(victim->clock);
+	fetchBlockInto(cache, blockNumber, block);
+}
+
+/*
+	Takes in a cache and writes every dirty block in its victim cache back
+	to main memory in address order. Like writeBackAll this does not change
+	any of the entries.
+*/
+void writeBackVictimCache(cache_t* cache) {
+	victimCache_t* victim = cache->victim;
+	if (victim == NULL) {
+		return;
+	}
+	uint32_t count = 0;
+	uint32_t addresses[victim->numBlocks];
+	for (uint32_t i = 0; i < victim->numBlocks; i++) {
+		if ((victim->flags[i] & (VALID_FLAG | DIRTY_FLAG)) == (VALID_FLAG | DIRTY_FLAG)) {
+			addresses[count++] = victim->addresses[i];
+		}
+	}
+	qsort(addresses, count, sizeof(uint32_t), compareAddresses);
+	for (uint32_t i = 0; i < count; i++) {
+		uint32_t entry = findVictimEntry(victim, addresses[i]);
+		writeBytesToMem(cache, addresses[i], victim->data + (uint64_t) entry * victim->blockDataSize, victim->blockDataSize);
+		reportVictimWriteBack(cache);
+	}
+}
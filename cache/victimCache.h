@@ -0,0 +1,75 @@
+/* Summer 2017 */
+#ifndef VICTIMCACHE_H
+#define VICTIMCACHE_H
+
+/*
+	Struct used to represent a small fully associative victim cache that
+	sits between a cache and its physical memory. Every block evicted from
+	the cache is placed in it along with its dirty bit and a miss in the
+	cache checks it before going to memory. The address of every entry is
+	the address of the first byte of its block and the flags use VALID_FLAG
+	and DIRTY_FLAG. The stamps record when every entry was inserted so the
+	oldest entry is replaced when the victim cache is full.
+*/
+typedef struct victimCache
+{
+	uint32_t numBlocks;
+	uint32_t blockDataSize;
+	uint32_t* addresses;
+	uint8_t* flags;
+	uint64_t* stamps;
+	uint64_t clock;
+	uint8_t* data;
+} victimCache_t;
+
+/*
+	Creates an empty victim cache that holds numBlocks blocks of
+	blockDataSize bytes. Returns NULL if numBlocks is 0.
+*/
+victimCache_t* createVictimCache(uint32_t numBlocks, uint32_t blockDataSize);
+
+/*
+	Frees a victim cache without writing any of its blocks back.
+*/
+void deleteVictimCache(victimCache_t* victim);
+
+/*
+	Takes in a victim cache and invalidates every entry without writing any
+	of them back.
+*/
+void clearVictimCache(victimCache_t* victim);
+
+/*
+	Takes in a cache and the address of the block that missed in it. If the
+	victim cache of the cache holds the block it is copied into data and
+	removed from the victim cache, the hit is reported, and its dirty bit is
+	returned. Returns -1 if the cache has no victim cache or the block is
+	not in it.
+*/
+int takeFromVictimCache(cache_t* cache, uint32_t address, uint8_t* data);
+
+/*
+	Takes in a cache and length bytes of data to be written at address. If
+	the victim cache of the cache holds the block of the address the data is
+	written into it and the entry is marked dirty if dirty is set. Returns 1
+	if the block was held and 0 otherwise, including when the cache has no
+	victim cache.
+*/
+int writeToVictimCache(cache_t* cache, uint32_t address, uint8_t* data, uint32_t length, uint8_t dirty);
+
+/*
+	Takes in a cache and the block number of a block that is being evicted
+	and places the block in the victim cache of the cache. If the victim
+	cache is full its oldest entry is replaced and written back to memory if
+	it is dirty. Blocks that are not valid are ignored.
+*/
+void evictToVictimCache(cache_t* cache, uint32_t blockNumber);
+
+/*
+	Takes in a cache and writes every dirty block in its victim cache back
+	to main memory in address order. Like writeBackAll this does not change
+	any of the entries.
+*/
+void writeBackVictimCache(cache_t* cache);
+
+#endif
@@ -0,0 +1,198 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "utils.h"
+#include "memBackend.h"
+#include "writeBuffer.h"
+
+/*
+	Takes in a write buffer and an address and returns the index of the
+	first run that ends at or after the address, which is the first run a
+	write to the address could be merged with.
+*/
+static uint32_t firstRun(writeBuffer_t* buffer, uint32_t address) {
+	uint32_t low = 0;
+	uint32_t high = buffer->numRuns;
+	while (low < high) {
+		uint32_t middle = low + (high - low) / 2;
+		writeBufferRun_t* run = &(buffer->runs[middle]);
+		if ((uint64_t) run->address + run->length < address) {
+			low = middle + 1;
+		} else {
+			high = middle;
+		}
+	}
+	return low;
+}
+
+/*
+	Creates an empty write buffer that holds up to capacity bytes. Returns
+	NULL if the capacity is 0.
+*/
+writeBuffer_t* createWriteBuffer(uint32_t capacity) {
+	if (capacity == 0) {
+		return NULL;
+	}
+	writeBuffer_t* buffer = malloc(sizeof(writeBuffer_t));
+	if (buffer == NULL) {
+		allocationFailed();
+	}
+	buffer->capacity = capacity;
+	buffer->used = 0;
+	buffer->numRuns = 0;
+	buffer->maxRuns = 8;
+	buffer->runs = malloc(sizeof(writeBufferRun_t) * buffer->maxRuns);
+	if (buffer->runs == NULL) {
+		free(buffer);
+		allocationFailed();
+	}
+	buffer->writes = 0;
+	buffer->coalesced = 0;
+	buffer->readHits = 0;
+	buffer->drains = 0;
+	return buffer;
+}
+
+/*
+	Frees a write buffer and every run it holds without writing them
+	anywhere.
+*/
+void deleteWriteBuffer(writeBuffer_t* buffer) {
+	if (buffer == NULL) {
+		return;
+	}
+	for (uint32_t i = 0; i < buffer->numRuns; i++) {
+		free(buffer->runs[i].data);
+	}
+	free(buffer->runs);
+	free(buffer);
+}
+
+/*
+	Takes in a write buffer and length bytes of data to be written to
+	physical memory at address and adds them to the buffer, merging them with
+	any runs they overlap or touch. Returns 1 if the buffer now holds more
+	than its capacity and must be drained and 0 otherwise.
+*/
+int insertWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data) {
+	uint64_t end = (uint64_t) address + length;
+	uint32_t low = firstRun(buffer, address);
+	uint32_t high = low;
+	while (high < buffer->numRuns && buffer->runs[high].address <= end) {
+		high++;
+	}
+	buffer->writes++;
+
+	// a repeated write to a block already held is copied in place
+	if (high == low + 1 && buffer->runs[low].address <= address
+		&& (uint64_t) buffer->runs[low].address + buffer->runs[low].length >= end) {
+		memcpy(buffer->runs[low].data + (address - buffer->runs[low].address), data, length);
+		buffer->coalesced++;
+		return buffer->used > buffer->capacity;
+	}
+
+	uint8_t* runData;
+	uint32_t start = address;
+	if (high == low) {
+		// nothing to merge with so a new run is inserted in address order
+		if (buffer->numRuns == buffer->maxRuns) {
+			buffer->maxRuns *= 2;
+			buffer->runs = realloc(buffer->runs, sizeof(writeBufferRun_t) * buffer->maxRuns);
+			if (buffer->runs == NULL) {
+				allocationFailed();
+			}
+		}
+		runData = malloc(sizeof(uint8_t) * length);
+		if (runData == NULL) {
+			allocationFailed();
+		}
+		memmove(&(buffer->runs[low + 1]), &(buffer->runs[low]), sizeof(writeBufferRun_t) * (buffer->numRuns - low));
+		buffer->numRuns++;
+	} else {
+		// every run from low to high is merged into one covering the write
+		writeBufferRun_t* last = &(buffer->runs[high - 1]);
+		if (buffer->runs[low].address < start) {
+			start = buffer->runs[low].address;
+		}
+		if ((uint64_t) last->address + last->length > end) {
+			end = (uint64_t) last->address + last->length;
+		}
+		runData = malloc(sizeof(uint8_t) * (end - start));
+		if (runData == NULL) {
+			allocationFailed();
+		}
+		for (uint32_t i = low; i < high; i++) {
+			writeBufferRun_t* run = &(buffer->runs[i]);
+			memcpy(runData + (run->address - start), run->data, run->length);
+			buffer->used -= run->length;
+			free(run->data);
+		}
+		memmove(&(buffer->runs[low + 1]), &(buffer->runs[high]), sizeof(writeBufferRun_t) * (buffer->numRuns - high));
+		buffer->numRuns -= high - low - 1;
+		buffer->coalesced++;
+	}
+	memcpy(runData + (address - start), data, length);
+	buffer->runs[low].address = start;
+	buffer->runs[low].length = (uint32_t) (end - start);
+	buffer->runs[low].data = runData;
+	buffer->used += buffer->runs[low].length;
+	return buffer->used > buffer->capacity;
+}
+
+/*
+	Takes in a write buffer and a range of physical memory. If a single run
+	holds the whole range it is copied into data and 1 is returned. Otherwise
+	data is left unchanged and 0 is returned.
+*/
+int readWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data) {
+	uint32_t index = firstRun(buffer, address);
+	if (index == buffer->numRuns) {
+		return 0;
+	}
+	writeBufferRun_t* run = &(buffer->runs[index]);
+	if (run->address > address || (uint64_t) run->address + run->length < (uint64_t) address + length) {
+		return 0;
+	}
+	memcpy(data, run->data + (address - run->address), length);
+	buffer->readHits++;
+	return 1;
+}
+
+/*
+	Takes in a write buffer and length bytes of data read from physical
+	memory at address and replaces every byte that has a newer value in
+	the buffer.
+*/
+void overlayWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data) {
+	uint64_t end = (uint64_t) address + length;
+	for (uint32_t i = firstRun(buffer, address); i < buffer->numRuns && buffer->runs[i].address < end; i++) {
+		writeBufferRun_t* run = &(buffer->runs[i]);
+		uint64_t runEnd = (uint64_t) run->address + run->length;
+		uint32_t start = run->address > address ? run->address : address;
+		uint64_t stop = runEnd < end ? runEnd : end;
+		if (stop > start) {
+			memcpy(data + (start - address), run->data + (start - run->address), stop - start);
+		}
+	}
+}
+
+/*
+	Takes in a write buffer and the backend it sits in front of and writes
+	every run to the backend in address order, leaving the buffer empty.
+*/
+void drainWriteBuffer(writeBuffer_t* buffer, memBackend_t* backend) {
+	if (buffer->numRuns == 0) {
+		return;
+	}
+	for (uint32_t i = 0; i < buffer->numRuns; i++) {
+		writeBufferRun_t* run = &(buffer->runs[i]);
+		backend->ops->writeBlock(backend, run->address, run->length, run->data);
+		free(run->data);
+	}
+	buffer->numRuns = 0;
+	buffer->used = 0;
+	buffer->drains++;
+}
@@ -0,0 +1,77 @@
+/* Summer 2017 */
+#ifndef WRITEBUFFER_H
+#define WRITEBUFFER_H
+
+/*
+	Struct used to hold one run of buffered writes. The run covers length
+	bytes of physical memory starting at address and never overlaps or
+	touches another run in the same buffer.
+*/
+typedef struct writeBufferRun
+{
+	uint32_t address;
+	uint32_t length;
+	uint8_t* data;
+} writeBufferRun_t;
+
+/*
+	Struct used to represent a bounded write back buffer. The runs are kept
+	sorted by address and writes to repeated or adjacent addresses are merged
+	into a single run. Used is the number of bytes held by all of the runs
+	and capacity is the number of bytes the buffer may hold before it has to
+	be drained. The remaining fields count how often the buffer was used.
+*/
+typedef struct writeBuffer
+{
+	uint32_t capacity;
+	uint32_t used;
+	uint32_t numRuns;
+	uint32_t maxRuns;
+	writeBufferRun_t* runs;
+	uint64_t writes;
+	uint64_t coalesced;
+	uint64_t readHits;
+	uint64_t drains;
+} writeBuffer_t;
+
+/*
+	Creates an empty write buffer that holds up to capacity bytes. Returns
+	NULL if the capacity is 0.
+*/
+writeBuffer_t* createWriteBuffer(uint32_t capacity);
+
+/*
+	Frees a write buffer and every run it holds without writing them
+	anywhere.
+*/
+void deleteWriteBuffer(writeBuffer_t* buffer);
+
+/*
+	Takes in a write buffer and length bytes of data to be written to
+	physical memory at address and adds them to the buffer, merging them with
+	any runs they overlap or touch. Returns 1 if the buffer now holds more
+	than its capacity and must be drained and 0 otherwise.
+*/
+int insertWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data);
+
+/*
+	Takes in a write buffer and a range of physical memory. If a single run
+	holds the whole range it is copied into data and 1 is returned. Otherwise
+	data is left unchanged and 0 is returned.
+*/
+int readWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data);
+
+/*
+	Takes in a write buffer and length bytes of data read from physical
+	memory at address and replaces every byte that has a newer value in
+	the buffer.
+*/
+void overlayWriteBuffer(writeBuffer_t* buffer, uint32_t address, uint32_t length, uint8_t* data);
+
+/*
+	Takes in a write buffer and the backend it sits in front of and writes
+	every run to the backend in address order, leaving the buffer empty.
+*/
+void drainWriteBuffer(writeBuffer_t* buffer, memBackend_t* backend);
+
+#endif
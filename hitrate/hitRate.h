@@ -17,4 +17,56 @@ void reportAccess(cache_t* cache);
 	Function used to update the cache indicating there has been a cache hit.
 */
 void reportHit(cache_t* cache);
+
+/*
+	Function used to return the fraction of accesses that missed in a cache
+	but hit in its victim cache.
+*/
+double findVictimHitRate(cache_t* cache);
+
+/*
+	Function used to update the cache indicating there has been a hit in
+	its victim cache.
+*/
+void reportVictimHit(cache_t* cache);
+
+/*
+	Function used to update the cache indicating a victim cache hit swapped
+	a valid block of the cache into the victim cache.
+*/
+void reportVictimSwap(cache_t* cache);
+
+/*
+	Function used to update the cache indicating a dirty block in its victim
+	cache has been written back to main memory.
+*/
+void reportVictimWriteBack(cache_t* cache);
+
+/*
+	Function used to update the cache indicating an eviction from it has
+	invalidated a copy of the block in one of its upper levels.
+*/
+void reportBackInvalidation(cache_t* cache);
+
+/*
+	Function used to return the fraction of the prefetches placed in a cache
+	that were used before they were evicted. Returns 0 if the cache has no
+	prefetcher or nothing has been prefetched.
+*/
+double findPrefetchAccuracy(cache_t* cache);
+
+/*
+	Function used to return the policy selection counter of a cache that
+	uses a set dueling replacement policy. Values below the midpoint mean the
+	follower sets use the first policy and values at or above it mean they
+	use the second.
+*/
+uint32_t findPsel(cache_t* cache);
+
+/*
+	Function used to return the replacement policy the follower sets of a
+	cache currently use. For DIP this is LRU or BIP and for DRRIP it is SRRIP
+	or BRRIP. Every other policy is returned unchanged.
+*/
+enum replacement findDuelingWinner(cache_t* cache);
 #endif
\ No newline at end of file
@@ -0,0 +1,46 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../cache/utils.h"
+#include "../cache/mem.h"
+#include "../cache/memBackend.h"
+#include "../cache/cacheRead.h"
+#include "hitRate.h"
+
+/*
+	Compares LRU with the adaptive insertion policies on a 64 KiB 8-way
+	cache with 64 byte blocks, which holds 1024 blocks. The trace loops 50
+	times over 1200 blocks, so LRU evicts every block just before it is
+	used again. LIP and BIP keep most of the loop in the cache. DIP uses
+	LRU in its LRU leader sets, which are a quarter of this cache's sets,
+	so it ends up lower. Prints the hit rate of each policy with the PSEL
+	counter and the policy the follower sets chose.
+*/
+int main() {
+	enum replacement policies[] = {LRU_REPLACEMENT, LIP_REPLACEMENT, BIP_REPLACEMENT, DIP_REPLACEMENT};
+	char* names[] = {"LRU", "LIP", "BIP", "DIP"};
+	uint32_t loopBlocks = 1200;
+	uint32_t blockDataSize = 64;
+	memBackend_t* memory = createArenaBackend();
+
+	for (unsigned int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+		cacheOptions_t options = defaultCacheOptions();
+		options.backend = memory;
+		options.replacement = policies[p];
+		cache_t* cache = createCacheWithOptions(8, blockDataSize, 64 * 1024, NULL, &options);
+		for (int round = 0; round < 50; round++) {
+			for (uint32_t i = 0; i < loopBlocks; i++) {
+				readByte(cache, MIN_ADDRESS + i * blockDataSize);
+			}
+		}
+		printf("%s hit rate %.3f psel %u", names[p], findHitRate(cache), findPsel(cache));
+		if (policies[p] == DIP_REPLACEMENT) {
+			printf(" followers use %s", findDuelingWinner(cache) == BIP_REPLACEMENT ? "BIP" : "LRU");
+		}
+		printf("\n");
+		deleteCache(cache);
+	}
+	releaseMemBackend(memory);
+	return 0;
+}
@@ -0,0 +1,100 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../cache/utils.h"
+#include "../cache/mem.h"
+#include "../cache/memBackend.h"
+#include "../cache/cacheRead.h"
+#include "hitRate.h"
+
+#define BLOCK_DATA_SIZE 64
+#define ROUNDS 200
+
+/*
+	Enum used to select the trace run on every policy. SHORT_SCAN and
+	MEDIUM_SCAN read a hot set of 512 blocks, 8 per set, twice and then scan
+	16 or 24 new blocks per set, one or one and a half times the ways. The
+	hot blocks have been reused when the scan starts, so SRRIP keeps them
+	while LRU lets the scan push them out before the next round. LONG_SCAN
+	reads the hot set once and then the next 1536 blocks of a scan over 8192
+	blocks, which is more than any policy can keep the hot set through
+	without inserting most scan blocks at the distant value. MOVING_SET
+	reads a set of 512 blocks twice and moves on to the next 512 blocks
+	every round, so a policy that inserts at the distant value loses blocks
+	before their second read.
+*/
+enum trace {SHORT_SCAN, MEDIUM_SCAN, LONG_SCAN, MOVING_SET};
+
+/*
+	Takes in a cache and a trace and makes the accesses of the trace.
+*/
+static void runTrace(cache_t* cache, enum trace trace) {
+	uint32_t scan = 0;
+	for (uint32_t round = 0; round < ROUNDS; round++) {
+		if (trace == SHORT_SCAN || trace == MEDIUM_SCAN) {
+			for (int pass = 0; pass < 2; pass++) {
+				for (uint32_t i = 0; i < 512; i++) {
+					readByte(cache, MIN_ADDRESS + i * BLOCK_DATA_SIZE);
+				}
+			}
+			for (uint32_t i = 0; i < (trace == SHORT_SCAN ? 1024 : 1536); i++) {
+				readByte(cache, MIN_ADDRESS + (512 + scan % 8192) * BLOCK_DATA_SIZE);
+				scan++;
+			}
+		} else if (trace == LONG_SCAN) {
+			for (uint32_t i = 0; i < 512; i++) {
+				readByte(cache, MIN_ADDRESS + i * BLOCK_DATA_SIZE);
+			}
+			for (uint32_t i = 0; i < 1536; i++) {
+				readByte(cache, MIN_ADDRESS + (512 + scan % 8192) * BLOCK_DATA_SIZE);
+				scan++;
+			}
+		} else {
+			uint32_t base = (round % 8) * 512;
+			for (int pass = 0; pass < 2; pass++) {
+				for (uint32_t i = 0; i < 512; i++) {
+					readByte(cache, MIN_ADDRESS + (base + i) * BLOCK_DATA_SIZE);
+				}
+			}
+		}
+	}
+}
+
+/*
+	Compares LRU with the RRIP policies on a 64 KiB 16-way cache with 64
+	byte blocks, which has 64 sets. On the short and medium scans SRRIP
+	keeps the whole hot set and LRU only hits on its second read. On the
+	long scan BRRIP keeps part of the hot set and SRRIP does not. On the
+	moving set SRRIP keeps every block until its second read and BRRIP does
+	not. DRRIP uses SRRIP in a quarter of the sets and BRRIP in another
+	quarter and its follower sets pick whichever of the two misses less, so
+	it follows the better policy on every trace. Prints the hit rate of each
+	policy and the policy the follower sets of DRRIP chose.
+*/
+int main() {
+	enum replacement policies[] = {LRU_REPLACEMENT, SRRIP_REPLACEMENT, BRRIP_REPLACEMENT, DRRIP_REPLACEMENT};
+	char* names[] = {"LRU", "SRRIP", "BRRIP", "DRRIP"};
+	enum trace traces[] = {SHORT_SCAN, MEDIUM_SCAN, LONG_SCAN, MOVING_SET};
+	char* traceNames[] = {"short scan", "medium scan", "long scan", "moving set"};
+	memBackend_t* memory = createArenaBackend();
+
+	for (unsigned int t = 0; t < sizeof(traces) / sizeof(traces[0]); t++) {
+		printf("%s:\n", traceNames[t]);
+		for (unsigned int p = 0; p < sizeof(policies) / sizeof(policies[0]); p++) {
+			cacheOptions_t options = defaultCacheOptions();
+			options.backend = memory;
+			options.replacement = policies[p];
+			cache_t* cache = createCacheWithOptions(16, BLOCK_DATA_SIZE, 64 * 1024, NULL, &options);
+			runTrace(cache, traces[t]);
+			printf("    %s hit rate %.3f", names[p], findHitRate(cache));
+			if (policies[p] == DRRIP_REPLACEMENT) {
+				printf(" followers use %s", findDuelingWinner(cache) == SRRIP_REPLACEMENT ? "SRRIP" : "BRRIP");
+			}
+			printf("\n");
+			deleteCache(cache);
+		}
+	}
+	releaseMemBackend(memory);
+	return 0;
+}
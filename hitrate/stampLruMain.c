@@ -0,0 +1,107 @@
+/* Summer 2017 */
+#include <stdio.h>
+#include <string.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include "../cache/utils.h"
+#include "../cache/mem.h"
+#include "../cache/memBackend.h"
+#include "../cache/cacheRead.h"
+#include "../cache/cacheWrite.h"
+#include "../cache/setInCache.h"
+#include "../cache/replacement.h"
+#include "hitRate.h"
+
+/*
+	Takes in a cache and a seed and makes a random trace of reads and
+	writes of every size over four times the data the cache holds. Returns
+	a hash of every value read so two caches can be compared.
+*/
+static uint64_t runTrace(cache_t* cache, uint64_t state, uint32_t totalDataSize) {
+	uint64_t values = 0;
+	for (int i = 0; i < 20000; i++) {
+		state ^= state << 13;
+		state ^= state >> 7;
+		state ^= state << 17;
+		uint32_t address = MIN_ADDRESS + (uint32_t) (state % (4 * totalDataSize));
+		uint64_t data = state >> 11;
+		switch ((state >> 40) % 6) {
+			case 0:
+				values = values * 31 + readByte(cache, address).data;
+				break;
+			case 1:
+				values = values * 31 + readWord(cache, address & ~3u).data;
+				break;
+			case 2:
+				values = values * 31 + readDoubleWord(cache, address & ~7u).data;
+				break;
+			case 3:
+				writeByte(cache, address, (uint8_t) data);
+				break;
+			case 4:
+				writeHalfWord(cache, address & ~1u, (uint16_t) data);
+				break;
+			default:
+				writeWord(cache, address & ~3u, (uint32_t) data);
+				break;
+		}
+	}
+	return values;
+}
+
+/*
+	Checks that STAMP_LRU evicts the same blocks as LRU. Runs the same
+	random trace on an LRU cache and a STAMP_LRU cache for several shapes
+	and both layouts, once with the clocks of every set starting at 0 and
+	once with them starting just below the point where they wrap around
+	and the stamps are renumbered. The caches must read the same values,
+	get the same number of hits, and leave the same data in physical
+	memory. Returns 1 if any run differs.
+*/
+int main() {
+	uint32_t shapes[][3] = {{2, 8, 256}, {4, 16, 1024}, {8, 32, 4096}, {16, 16, 2048}, {32, 8, 2048}, {64, 4, 256}};
+	enum layout layouts[] = {PACKED, ALIGNED};
+	long differences = 0;
+
+	for (unsigned int s = 0; s < sizeof(shapes) / sizeof(shapes[0]); s++) {
+		for (unsigned int l = 0; l < sizeof(layouts) / sizeof(layouts[0]); l++) {
+			for (int nearWrap = 0; nearWrap < 2; nearWrap++) {
+				memBackend_t* lruMemory = createArenaBackend();
+				memBackend_t* stampMemory = createArenaBackend();
+				cacheOptions_t options = defaultCacheOptions();
+				options.layout = layouts[l];
+				options.backend = lruMemory;
+				options.replacement = LRU_REPLACEMENT;
+				cache_t* lru = createCacheWithOptions(shapes[s][0], shapes[s][1], shapes[s][2], NULL, &options);
+				options.backend = stampMemory;
+				options.replacement = STAMP_LRU_REPLACEMENT;
+				cache_t* stamp = createCacheWithOptions(shapes[s][0], shapes[s][1], shapes[s][2], NULL, &options);
+				if (nearWrap) {
+					for (uint32_t set = 0; set < stamp->geometry.numSets; set++) {
+						setSetState(stamp, set, UINT32_MAX - 3 - set % 5);
+					}
+				}
+
+				uint64_t seed = 88172645463325252ULL + s;
+				uint64_t lruValues = runTrace(lru, seed, shapes[s][2]);
+				uint64_t stampValues = runTrace(stamp, seed, shapes[s][2]);
+				double lruHits = lru->hit;
+				double stampHits = stamp->hit;
+				contextSwitch(lru);
+				contextSwitch(stamp);
+				if (lruValues != stampValues || lruHits != stampHits
+					|| memcmp(lruMemory->memory, stampMemory->memory, MEMORY_SIZE) != 0) {
+					printf("STAMP_LRU differs from LRU: n %u block %u size %u layout %u near wrap %d hits %.0f/%.0f\n",
+						shapes[s][0], shapes[s][1], shapes[s][2], l, nearWrap, stampHits, lruHits);
+					differences++;
+				}
+				deleteCache(lru);
+				deleteCache(stamp);
+				releaseMemBackend(lruMemory);
+				releaseMemBackend(stampMemory);
+			}
+		}
+	}
+	printf("%ld runs of STAMP_LRU differ from LRU\n", differences);
+	return differences != 0;
+}